@@ -2,200 +2,312 @@
 #include <map>
 #include <vector>
 #include <cmath>
+#include <algorithm>
+#include <numeric>
 
 #include "rounding.h"
+#include "classification.h"
+#include "unround.h"
+#include "smalljobs.h"
 #include "scheduler.h"
 #include "convolution.h"
 #include "heuristic.h"
+#include "bounds.h"
 #include "bdjr.h"
+#include "interrupt.h"
+#include "log.h"
 
 using namespace PCmax;
 
-typedef Rounding9<0> R;
-
-inline nat ScheduleHugeJobs(double eps, nat T, std::map<nat,nat>& jobs, Schedule& S) {
+/*
+ * Every huge job goes to a machine of its own, together with the largest
+ * medium jobs that fit below T if there are any; pair(p, p_, k) is called
+ * for k machines with a huge job p and a medium job p_ (0 if alone). The
+ * paired medium jobs are counted down in C.
+ *
+ * Two pointers: the huge jobs come in decreasing order, so the largest
+ * medium job that fits only moves to larger jobs. Medium sizes used up
+ * are skipped through C.skip (next size with jobs left, path halving).
+ */
+template<class R, class Pair>
+inline nat PairHugeJobs(JobClasses<R>& C, Pair pair) {
+
+  nat T = C.T;
+  auto& medium = C.medium_jobs;
+  auto& skip = C.skip;
+  skip.resize(medium.size() + 1);
+  for (std::size_t i = 0; i <= medium.size(); ++i) skip[i] = i;
+  auto next = [&skip](std::size_t i) {
+    while (skip[i] != i) i = skip[i] = skip[skip[i]];
+    return i;
+  };
 
   nat huge_machines = 0;
+  std::size_t fit = medium.size(); // first medium job <= T-p
+
+  for (auto const& h : C.huge_jobs) {
+    nat p = h.p;
+    nat remove = h.a;
 
-  for (auto i = jobs.rbegin(); i != jobs.rend(); ++i) {
-    nat p = i->first;
-    nat a = i->second;
-    double p1 = p / (double)T; // normalized
-
-    if (p1 < 1-2*eps) break;
-
-    nat remove = a;
-    std::map<nat,nat>::reverse_iterator j(i); ++j;
-    while (j != jobs.rend() && remove > 0) {
-      nat p_ = j->first;
-      nat a_ = j->second;
-
-      double p1_ = p_ / (double)T; // normalized
-      if (p1_ <= eps) break;
-
-      if (p <= T && p_ <= T-p) {// largest possible job(s)
-        nat rem = std::min(a_, remove);
-        for (nat k = 0; k < rem; ++k) S.push_back(std::vector<nat>{p,p_});
-        huge_machines += rem;
-        if (a_ <= remove) {
-          jobs.erase(std::next(j).base()); // remove item j
-        } else {
-          j->second -= rem;
-        }
-        remove -= rem;
-      }
-      else ++j;
+    if (p <= T) {
+      while (fit > 0 && medium[fit-1].p <= T-p) --fit;
     }
-    huge_machines += remove;
-    while (remove-- > 0) {
-      // not enough medium jobs - store them alone!
-      S.push_back(std::vector<nat>{p});
+    for (std::size_t j = next(fit); j < medium.size() && remove > 0; j = next(j)) {
+      nat rem = std::min(medium[j].a, remove);
+      pair(p, medium[j].p, rem);
+      huge_machines += rem;
+      remove -= rem;
+      if ((medium[j].a -= rem) == 0) skip[j] = j+1;
     }
+    // not enough medium jobs - store them alone!
+    if (remove > 0) pair(p, 0, remove);
+    huge_machines += remove;
   }
 
   return huge_machines;
 }
 
-inline bool DualMakespanTask(double eps, const Instance& I, nat T, nat& m_min) {
+/* Machines of the huge jobs without their schedule. */
+template<class R>
+inline nat CountHugeMachines(JobClasses<R>& C) {
+  return PairHugeJobs<R>(C, [](nat, nat, nat) {});
+}
+
+template<class R>
+inline nat ScheduleHugeJobs(JobClasses<R>& C, Schedule& S) {
+  return PairHugeJobs<R>(C, [&S](nat p, nat p_, nat k) {
+    while (k-- > 0) S.push_back(p_ > 0 ? std::vector<nat>{p,p_} : std::vector<nat>{p});
+  });
+}
+
+template<class R>
+inline void RoundMediumJobs(const JobClasses<R>& C, Vector<R>& b) {
+  for (auto const& j : C.medium_jobs) b[j.j] += j.a;
+}
+
+/* C is scratch, reused by the probes of ComputeFirstMakespan. */
+template<class R>
+inline bool DualMakespanTask(double eps, const Instance& I, nat T, JobClasses<R>& C, nat& m_min) {
   nat m = I.GetM();
-  std::map<nat,nat> jobs(I.GetMap()); // copy
+  C.SetMakespan(eps, T);
+  C.Classify(I.GetMap());
 
-  nat huge_machines;
-  { Schedule S; huge_machines = ScheduleHugeJobs(eps, T, jobs, S); }
+  nat huge_machines = CountHugeMachines<R>(C);
   if (huge_machines > m) return false;
 
   nat m_med = m - huge_machines; // machines for medium jobs
 
   Vector<R> b;
   b.Reset();
+  RoundMediumJobs<R>(C, b);
 
-  for (auto i = jobs.rbegin(); i != jobs.rend(); i++) {
-  	nat p = i->first;
-  	nat a = i->second;
-  	double p1 = p / (double)T; // normalized
-    //std::cout << p1 << "," << std::flush;
-  	if (p1 <= eps) break;
-    if (p1 >= 1-2*eps) continue;
-    b[R::GetRoundedIndex(p1)] += a;
-  }
-
-  m_min = Scheduler<R, FFTConvolution<R>>::MinMachines(b);
+  m_min = Scheduler<R, AutoConvolution<R>>::MinMachines(b);
   return (m_min <= m_med);
 }
 
+template<class R>
 inline nat ComputeFirstMakespan(double eps, const Instance& I, nat& m_min) {
 
-  nat l = LowerBound(I);
   nat u = MF::ComputeMakespan(I);
+  nat l = Bounds::LowerBound(I, u);
+  JobClasses<R> C(eps, u);
   bool ok = false;
   do {
     nat T = (l + u) / 2;
     nat m;
-    if (DualMakespanTask(eps, I, T, m)) {
+    if (Interrupt::Requested()) return u;
+    if (DualMakespanTask<R>(eps, I, T, C, m)) {
       ok = true;
       u = T;
       m_min = m;
     } else l = T+1;
   } while (l < u);
 
-  if (!ok) ok = DualMakespanTask(eps, I, u, m_min);
-  if (!ok) std::cout << "NOT OK!" << std::endl;
+  if (!ok) ok = DualMakespanTask<R>(eps, I, u, C, m_min);
+  if (!ok) std::cerr << "NOT OK!" << std::endl;
 
   return u;
 }
 
-inline void RoundMediumJobs(double eps, nat T, const std::map<nat,nat>& jobs, Vector<R>& b) {
-  for (auto i = jobs.rbegin(); i != jobs.rend(); ++i) {
-    nat p = i->first;
-    nat a = i->second;
-    double p1 = p / (double)T; // normalized
+template<class R>
+inline Instance SmallJobs(const JobClasses<R>& C, nat m) {
+  std::map<nat,nat> small_jobs;
+  for (auto i = C.small_jobs.rbegin(); i != C.small_jobs.rend(); ++i) {
+    small_jobs.emplace_hint(small_jobs.end(), i->p, i->a);
+  }
+  return Instance(m, small_jobs);
+}
+
+/*
+ * The main algorithm, also fills state if given.
+ */
+template<class R>
+nat Solve(const Instance& I, Schedule& S, BDJR::State* state) {
 
-    if (p1 >= 1-2*eps) continue;
-    if (p1 <= eps) break;
+  //double eps = 0.172874755859;
+  constexpr double eps = Epsilon<R>();
+  nat m = I.GetM();
+
+  nat m_min = m;
+  nat T = ComputeFirstMakespan<R>(eps, I, m_min);
+  if (Interrupt::Requested()) return 0;
+  LOG << "First Makespan: T = " << T << std::endl;
 
-    b[R::GetRoundedIndex(p1)] += a;
+  JobClasses<R> C(eps, T);
+  C.Classify(I.GetMap());
+  nat huge_machines = ScheduleHugeJobs<R>(C, S);
+  LOG << "AfterScheduleHugeJobs: S = " << S << std::endl;
+
+  Vector<R> b;
+  b.Reset();
+  RoundMediumJobs<R>(C, b);
+  LOG << "AfterRoundMediumJobs: b = " << b << std::endl;
+
+  Configurations<R> S_;
+  Scheduler<R, AutoConvolution<R>>::ComputeSchedule(b, m_min, S_);
+  if (Interrupt::Requested()) return 0;
+  if (verbose) {
+    std::cout << "AfterComputeScheduleBeforeUnround: S_ = ";
+    for (auto& c : S_) std::cout << c.first << " x " << c.second << ", ";
+    std::cout << std::endl;
   }
-}
 
-inline void UnroundScheduleOfMediumJobs(double eps, nat T, nat huge_machines,
-  const std::map<nat,nat>& jobs, std::vector<Vector<R>>& S_, Schedule& S) {
-  std::vector<nat> loads(S_.size());
-  for (auto i = jobs.rbegin(); i != jobs.rend(); i++) {
-    nat p = i->first;
-    nat a = i->second;
-    double p1 = p / (double)T; // normalized
-
-    if (p1 >= 1-2*eps) continue;
-    if (p1 <= eps) break;
-
-    int j = R::GetRoundedIndex(p1);
-    for (nat k = 0; k < a; k++) {
-      nat u = huge_machines;
-      double minload = T;
-      nat u_minload = u;
-      for (auto& c : S_) {
-        nat load = loads[u-huge_machines];
-        if (c[j] > 0 && load < minload) {
-          u_minload = u;
-          minload = load;
-        }
-        ++u;
-      }
-      --S_[u_minload-huge_machines][j];
-      S.AddLoad(u_minload, p);
-      loads[u_minload-huge_machines] += minload;
-    }
+  nat machines = 0;
+  for (auto& c : S_) machines += c.second;
+  S.resize(S.size() + machines);
+
+  UnroundScheduleOfMediumJobs<R>(C, huge_machines, S_, S);
+  LOG << "AfterUnroundBeforeLPT: S = " << S << std::endl;
+
+  LOG << SmallJobs<R>(C, m) << std::endl;
+
+  if (!state) return PlaceSmallJobs<R>(C, m, S);
+
+  state->T = T;
+  state->huge_machines = huge_machines;
+  state->b.assign(R::Dim(), 0);
+  for (int d = 0; d < R::Dim(); ++d) state->b[d] = b[d];
+  state->configurations.clear();
+  for (auto& c : S_) {
+    std::vector<int> column(R::Dim());
+    for (int d = 0; d < R::Dim(); ++d) column[d] = c.first[d];
+    state->configurations.emplace_back(std::move(column), c.second);
   }
+  std::vector<nat> loads(m); // without the small jobs
+  for (nat u = 0; u < S.size(); ++u) loads[u] = std::accumulate(S[u].begin(), S[u].end(), nat(0));
+  nat makespan = PlaceSmallJobs<R>(C, m, S);
+  state->small_loads.assign(m, 0);
+  for (nat u = 0; u < S.size(); ++u) {
+    state->small_loads[u] = std::accumulate(S[u].begin(), S[u].end(), nat(0)) - loads[u];
+  }
+  return makespan;
 }
 
-inline void GetSmallJobs(double eps, nat T, const std::map<nat,nat>& jobs, std::map<nat,nat>& small_jobs) {
-  for (auto i = jobs.begin(); i != jobs.end(); i++) {
-    nat p = i->first;
-    nat a = i->second;
-    double p1 = p / (double)T; // normalized
-    if (p1 > eps) break;
-    small_jobs[p] = a;
-  }
+template<class R>
+nat SolveSchedule(const Instance& I, Schedule& S) {
+  return Solve<R>(I, S, nullptr);
+}
+
+template<class R>
+nat SolveState(const Instance& I, Schedule& S, BDJR::State& state) {
+  return Solve<R>(I, S, &state);
 }
 
 /*
- * The main algorithm.
+ * A medium job is at most the next larger size of its class (or 1-2*eps)
+ * and hence at most this factor larger than its rounded size.
  */
-nat BDJR::ComputeSchedule(const Instance& I, Schedule& S) {
+template<class R>
+constexpr double Ratio() {
+  constexpr double eps = Epsilon<R>();
+  double ratio = 1 + eps;
+  for (int i = 0; i < R::Dim(); ++i) {
+    double s = R::Size(i) / (double)R::Makespan();
+    double next = 1 - 2*eps;
+    for (int j = 0; j < R::Dim(); ++j) {
+      double s_ = R::Size(j) / (double)R::Makespan();
+      if (s_ > s && s_ < next) next = s_;
+    }
+    if (next / s > ratio) ratio = next / s;
+  }
+  return ratio;
+}
 
-  //double eps = 0.172874755859;
-  double eps = 0.1754019165039063;
-  nat m = I.GetM();
-  std::map<nat,nat> jobs(I.GetMap());// copy
+#define BDJR_ROUNDING_INFO(R, name) \
+  BDJR::RoundingInfo{name, R::Dim(), Epsilon<R>(), Ratio<R>(), &SolveSchedule<R>, &SolveState<R>},
 
-  nat m_min = m;
-  nat T = ComputeFirstMakespan(eps, I, m_min);
-  std::cout << "First Makespan: T = " << T << std::endl;
+const std::vector<BDJR::RoundingInfo>& BDJR::Roundings() {
+  static const std::vector<RoundingInfo> roundings{
+    BDJR_ROUNDINGS_LIST(BDJR_ROUNDING_INFO)
+  };
+  return roundings;
+}
 
-  nat huge_machines = ScheduleHugeJobs(eps, T, jobs, S);
-  std::cout << "AfterScheduleHugeJobs: S = " << S << std::endl;
+static const BDJR::RoundingInfo* selected = &BDJR::Roundings().front();
 
-  Vector<R> b;
-  b.Reset();
-  RoundMediumJobs(eps, T, jobs, b);
-  std::cout << "AfterRoundMediumJobs: b = " << b << std::endl;
+bool BDJR::SelectRounding(const std::string& rounding) {
+  for (auto const& r : Roundings()) {
+    if (rounding == r.name) {
+      selected = &r;
+      return true;
+    }
+  }
+  return false;
+}
 
-  std::vector<Vector<R>> S_;
-  Scheduler<R, FFTConvolution<R>>::ComputeSchedule(b, m_min, S_);
-  std::cout << "AfterComputeScheduleBeforeUnround: S_ = "; for (auto& c : S_) std::cout << c << ", "; std::cout << std::endl;
+const BDJR::RoundingInfo& BDJR::SelectedRounding() {
+  return *selected;
+}
+
+nat BDJR::ComputeSchedule(const Instance& I, Schedule& S) {
+  return selected->ComputeSchedule(I, S);
+}
 
-  for (nat i = 0; i < S_.size(); i++) {
-    std::vector<nat> u;
-    S.push_back(u);
+nat BDJR::ComputeSchedule(const Instance& I, Schedule& S, const std::string& rounding) {
+  for (auto const& r : Roundings()) {
+    if (rounding == r.name) return r.ComputeSchedule(I, S);
   }
+  return 0;
+}
 
-  UnroundScheduleOfMediumJobs(eps, T, huge_machines, jobs, S_, S);
-  std::cout << "AfterUnroundBeforeLPT: S = " << S << std::endl;
+const char* BDJR::StageName(Stage stage) {
+  switch (stage) {
+    case Stage::LPT: return "LPT";
+    case Stage::MF: return "MF";
+    case Stage::BDJR: return "BDJR";
+  }
+  return "";
+}
 
-  std::map<nat,nat> small_jobs;
-  GetSmallJobs(eps, T, jobs, small_jobs);
-  Instance I_small(m, small_jobs);
-  std::cout << I_small << std::endl;
+nat BDJR::ComputeSchedule(const Instance& I, Schedule& S, std::chrono::milliseconds budget, Stage& stage) {
+  return ComputeSchedule(I, S, budget, stage, *selected);
+}
 
-  return LPT::ComputeSchedule(I_small, S);// schedule small jobs on top of S
+nat BDJR::ComputeSchedule(const Instance& I, Schedule& S, std::chrono::milliseconds budget, Stage& stage,
+  const RoundingInfo& rounding) {
+  Interrupt::Deadline deadline(std::chrono::steady_clock::now() + budget);
+
+  Schedule S_;
+  nat T = LPT::ComputeSchedule(I, S_);
+  S.swap(S_);
+  stage = Stage::LPT;
+  if (Interrupt::Requested()) return T;
+
+  S_.clear();
+  nat T_ = MF::ComputeSchedule(I, S_);
+  if (T_ < T) {
+    T = T_;
+    S.swap(S_);
+    stage = Stage::MF;
+  }
+  if (Interrupt::Requested()) return T;
+
+  S_.clear();
+  T_ = rounding.ComputeSchedule(I, S_);
+  if (T_ > 0 && T_ < T) { // 0 if interrupted
+    T = T_;
+    S.swap(S_);
+    stage = Stage::BDJR;
+  }
+  return T;
 }
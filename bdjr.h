@@ -1,15 +1,80 @@
 #ifndef BDJR_H_
 #define BDJR_H_
 
+#include <chrono>
+#include <string>
+#include <utility>
+#include <vector>
+
 #include "pcmax.h"
 
 namespace PCmax { namespace BDJR {
 
   /*
-   * Solves instance I to schedule S and returns the makespan of S.
+   * Solves instance I to schedule S and returns the makespan of S, or 0 if
+   * the computation was interrupted (see interrupt.h).
    */
   nat ComputeSchedule(const Instance& I, Schedule& S);
 
+  /*
+   * Same as above with the given rounding instead of the selected one.
+   * Returns 0 and leaves S untouched if there is no such rounding.
+   */
+  nat ComputeSchedule(const Instance& I, Schedule& S, const std::string& rounding);
+
+  /*
+   * Supporting state of a solve for the makespan T, for repairing S when the
+   * jobs change (see DynamicSchedule). The first huge_machines machines of S
+   * run the huge jobs, each with at most one paired medium job. The next ones
+   * run the remaining medium jobs, rounded to the vector b (jobs per class),
+   * as the configuration columns with their numbers of machines. The small
+   * jobs on top of the machines add up to small_loads.
+   */
+  struct State {
+    nat T = 0;
+    nat huge_machines = 0;
+    std::vector<int> b;
+    std::vector<std::pair<std::vector<int>, int>> configurations;
+    std::vector<nat> small_loads;
+  };
+
+  struct RoundingInfo {
+    const char* name;
+    int dim;     // dimension of the configuration tensors (6^dim entries)
+    double eps;  // small jobs are at most eps, huge jobs at least 1-2*eps
+    double ratio; // guaranteed makespan relative to the optimum
+    nat (*ComputeSchedule)(const Instance&, Schedule&);
+    nat (*ComputeState)(const Instance&, Schedule&, State&); // also fills the state
+  };
+
+  /*
+   * The compiled roundings, see BDJR_ROUNDINGS_LIST.
+   */
+  const std::vector<RoundingInfo>& Roundings();
+
+  /*
+   * Selects the rounding used by ComputeSchedule(I, S), rounding9 by default.
+   */
+  bool SelectRounding(const std::string& rounding);
+
+  const RoundingInfo& SelectedRounding();
+
+  enum class Stage { LPT, MF, BDJR };
+
+  const char* StageName(Stage stage);
+
+  /*
+   * Anytime variant with a time budget: returns the best schedule among LPT,
+   * MF and BDJR (selected rounding) that was completed in time. BDJR is
+   * stopped cooperatively when the budget is exceeded. stage reports which
+   * algorithm produced S.
+   */
+  nat ComputeSchedule(const Instance& I, Schedule& S, std::chrono::milliseconds budget, Stage& stage);
+
+  /* Same as above with the given rounding instead of the selected one. */
+  nat ComputeSchedule(const Instance& I, Schedule& S, std::chrono::milliseconds budget, Stage& stage,
+    const RoundingInfo& rounding);
+
 }}
 
 #endif
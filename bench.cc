@@ -0,0 +1,320 @@
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+#include <omp.h>
+
+#include "rounding.h"
+#include "tensor.h"
+#include "convolution.h"
+#include "scheduler.h"
+#include "shard.h"
+#include "bdjr.h"
+#include "heuristic.h"
+#include "generator.h"
+#include "log.h"
+
+/*
+ * Microbenchmark of the convolution engines. For every selected rounding of
+ * ROUNDINGS_LIST, padded-* and cheap-* being the padded variants, Square is
+ * timed on three inputs:
+ *   init     the initial tensor of the base anchor (first fixed-point round)
+ *   fixpoint the converged tensor of the base anchor, squared into the next
+ *            anchor (first recursive step of MinMachines)
+ *   random   30% random entries with values up to 8
+ * with every engine and thread count. The results are compared entry by
+ * entry with those of the first engine.
+ *
+ * With --scaling=FAMILY, LPT, MF and BDJR are timed instead on generated
+ * instances of the family (see generator.h) for every number of machines
+ * and jobs.
+ */
+
+using namespace PCmax;
+using namespace std;
+
+struct Options {
+  vector<string> roundings;
+  vector<string> engines = {"parallel", "fft", "ntt", "blocked", "auto"};
+  vector<int> threads;
+  int repeat = 3;
+  int processes = 2;
+  unsigned seed = 1;
+  string scaling; // family of the scaling sweep
+  vector<nat> machines = {10, 100, 1000};
+  vector<nat> jobs = {1000, 10000, 100000};
+};
+
+static vector<string> Split(const char* list) {
+  vector<string> items;
+  string item;
+  for (const char* c = list; ; ++c) {
+    if (*c == ',' || *c == 0) {
+      if (!item.empty()) items.push_back(item);
+      item.clear();
+      if (*c == 0) break;
+    } else item += *c;
+  }
+  return items;
+}
+
+static double PeakMemoryMB() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss / 1024.0; // KB on Linux
+}
+
+/* Name of a rounding of ROUNDINGS_LIST, those of BDJR as in BDJR_ROUNDINGS_LIST. */
+template<class R> struct RoundingName;
+template<int unused> struct RoundingName<Rounding9<unused>> {
+  static string Get() { return "rounding9"; }
+};
+template<int unused> struct RoundingName<Rounding10<unused>> {
+  static string Get() { return "rounding10"; }
+};
+template<int K> struct RoundingName<ArithmeticRounding<K>> {
+  static string Get() { return "arithmetic" + to_string(K); }
+};
+template<class R> struct RoundingName<PaddedRounding<R>> {
+  static string Get() { return "padded-" + RoundingName<R>::Get(); }
+};
+template<class R> struct RoundingName<CheapPaddedRounding<R>> {
+  static string Get() { return "cheap-" + RoundingName<R>::Get(); }
+};
+
+// NTTConvolution is only instantiated for the unpadded roundings
+template<class R> struct HasNTT : false_type {};
+#define BENCH_HAS_NTT(R) template<> struct HasNTT<R> : true_type {};
+UNPADDED_ROUNDINGS_LIST(BENCH_HAS_NTT)
+
+template<class R>
+using SquareFn = size_t (*)(Tensor<R>&, const Tensor<R>&, const Vector<R>&, const Vector<R>&);
+
+template<class R>
+static SquareFn<R> Engine(const string& name) {
+  if (name == "naive") return &NaiveConvolution<R>::Square;
+  if (name == "parallel") return &ParallelNaiveConvolution<R>::Square;
+  if (name == "fft") return &FFTConvolution<R>::Square;
+  if (name == "sharded") return &ShardedFFTConvolution<R>::Square;
+  if constexpr (HasNTT<R>::value) {
+    if (name == "ntt") return &NTTConvolution<R>::Square;
+  }
+  if (name == "blocked") return &BlockedConvolution<R>::Square;
+  if (name == "auto") return &AutoConvolution<R>::Square;
+  return nullptr;
+}
+
+template<class R>
+static void Bench(const char* rounding, const char* input, const Tensor<R>& source,
+  const Vector<R>& target_anchor, const Vector<R>& source_anchor, const Options& options) {
+
+  Tensor<R> target, reference;
+  bool have_reference = false;
+  size_t reference_changed = 0;
+
+  for (auto const& engine : options.engines) {
+    if (engine == "ntt" && !HasNTT<R>::value) continue;
+    SquareFn<R> square = Engine<R>(engine);
+    if (!square) {
+      cerr << "Unknown engine " << engine << endl;
+      exit(1);
+    }
+    // only the sharded engine, auto stays within the process
+    Shard::SetProcesses(engine == "sharded" ? options.processes : 0);
+    for (int threads : options.threads) {
+      omp_set_num_threads(threads);
+      double best = 1e100, total = 0;
+      size_t changed = 0;
+      for (int r = 0; r < options.repeat; ++r) {
+        auto start = chrono::steady_clock::now();
+        changed = square(target, source, target_anchor, source_anchor);
+        auto stop = chrono::steady_clock::now();
+        double ms = chrono::duration<double, milli>(stop - start).count();
+        best = min(best, ms);
+        total += ms;
+      }
+
+      string diff = "reference";
+      if (!have_reference) {
+        target.swap(reference);
+        reference_changed = changed;
+        have_reference = true;
+      } else {
+        size_t differences = Diff(reference, target, cerr);
+        diff = differences == 0 && changed == reference_changed ? "same" :
+          to_string(differences) + " entries, changed " + to_string(changed) + " vs " + to_string(reference_changed);
+      }
+
+      printf("%-20s %3d %-9s %-9s %3d %10.2f %10.2f %10.2f %10zu %9.1f  %s\n",
+        rounding, R::Dim(), input, engine.c_str(), threads, best, total / options.repeat,
+        Tensor<R>::data_size() / best / 1000.0, changed, PeakMemoryMB(), diff.c_str());
+      fflush(stdout);
+    }
+  }
+}
+
+template<class R>
+static void BenchRounding(const char* rounding, const Options& options) {
+  mt19937 rng(options.seed);
+
+  // Chain of anchors from a random b down to the base anchor, which is its
+  // own previous interval
+  Vector<R> b;
+  for (int i = 0; i < R::Dim(); ++i) b[i] = 8 + rng() % 24;
+  vector<Vector<R>> anchors(1, b);
+  while (true) {
+    Vector<R> previous;
+    for (int i = 0; i < R::Dim(); ++i) previous[i] = R::PreviousInterval(i, anchors.back()[i]);
+    if (previous == anchors.back()) break;
+    anchors.push_back(previous);
+  }
+  const Vector<R>& base = anchors.back();
+  const Vector<R>& next = anchors.size() > 1 ? anchors[anchors.size() - 2] : base;
+
+  Tensor<R> init;
+  Vector<R> anchor = base;
+  init.Initialize(anchor);
+  Bench<R>(rounding, "init", init, base, base, options);
+
+  Tensor<R> fixpoint, trash;
+  Scheduler<R, AutoConvolution<R>>::MinMachines(fixpoint, trash, base);
+  Bench<R>(rounding, "fixpoint", fixpoint, next, base, options);
+
+  Tensor<R> random;
+  uniform_int_distribution<int> value(0, 8);
+  for (size_t i = 0; i < Tensor<R>::data_size(); ++i) {
+    random.data_unsafe()[i] = rng() % 10 < 3 ? value(rng) : -1;
+  }
+  Bench<R>(rounding, "random", random, base, base, options);
+}
+
+static void BenchScaling(const Options& options) {
+  Generator::Parameters P;
+  if (!Generator::ParseFamily(options.scaling, P)) {
+    cerr << "Unknown family " << options.scaling << endl;
+    exit(1);
+  }
+  const char* rounding = options.roundings.empty() ? BDJR::SelectedRounding().name : options.roundings.front().c_str();
+  if (none_of(BDJR::Roundings().begin(), BDJR::Roundings().end(),
+      [rounding](const BDJR::RoundingInfo& r) { return !strcmp(r.name, rounding); })) {
+    cerr << "Unknown rounding " << rounding << endl;
+    exit(1);
+  }
+  struct Algorithm {
+    const char* name;
+    function<nat(const Instance&, Schedule&)> run;
+  };
+  vector<Algorithm> algorithms = {
+    {"LPT", &LPT::ComputeSchedule},
+    {"MF", &MF::ComputeSchedule},
+    {"BDJR", [rounding](const Instance& I, Schedule& S) { return BDJR::ComputeSchedule(I, S, rounding); }},
+  };
+
+  printf("%-12s %6s %9s %-5s %10s %10s %8s %9s\n", "family", "m", "n", "algo", "min ms", "makespan", "ratio", "maxrss MB");
+  for (nat m : options.machines) {
+    for (nat n : options.jobs) {
+      P.m = m;
+      P.n = n;
+      P.seed = options.seed;
+      if (!Generator::IsValid(P)) continue;
+      Instance I;
+      auto start = chrono::steady_clock::now();
+      Generator::Generate(P, I);
+      double generate = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+      nat lower = LowerBound(I);
+      printf("%-12s %6llu %9llu %-5s %10.2f\n", options.scaling.c_str(), (unsigned long long)m,
+        (unsigned long long)n, "gen", generate);
+
+      for (auto const& algorithm : algorithms) {
+        double best = 1e100;
+        nat makespan = 0;
+        for (int r = 0; r < options.repeat; ++r) {
+          Schedule S;
+          auto start = chrono::steady_clock::now();
+          makespan = algorithm.run(I, S);
+          best = min(best, chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+        }
+        printf("%-12s %6llu %9llu %-5s %10.2f %10llu %8.5f %9.1f\n", options.scaling.c_str(),
+          (unsigned long long)m, (unsigned long long)n, algorithm.name, best,
+          (unsigned long long)makespan, makespan / (double)lower, PeakMemoryMB());
+        fflush(stdout);
+      }
+    }
+  }
+}
+
+static void Usage(const char* program) {
+  cerr << "Usage: " << program << " [options]" << endl
+       << "  --rounding=NAME     rounding to benchmark, repeatable (default: those of BDJR of dimension <= 6)" << endl
+       << "  --engines=A,B,...   naive, parallel, fft, sharded, ntt, blocked, auto (default: all but naive and sharded)" << endl
+       << "  --processes=N       worker processes of sharded (default: 2)" << endl
+       << "  --threads=T1,T2,... thread counts (default: 1 and all)" << endl
+       << "  --repeat=N          runs per measurement (default: 3)" << endl
+       << "  --seed=S            seed of the random anchors, tensors and instances" << endl
+       << "  --scaling=FAMILY    time LPT, MF and BDJR (first --rounding) on generated instances, U<a>_<b> or NU<R>" << endl
+       << "  --machines=M1,...   machine counts of --scaling (default: 10,100,1000)" << endl
+       << "  --jobs=N1,...       job counts of --scaling (default: 1000,10000,100000)" << endl;
+}
+
+int main(int argc, const char* argv[]) {
+  Options options;
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    if (!strncmp(arg, "--rounding=", 11)) options.roundings.push_back(arg + 11);
+    else if (!strncmp(arg, "--engines=", 10)) options.engines = Split(arg + 10);
+    else if (!strncmp(arg, "--threads=", 10)) {
+      for (auto const& t : Split(arg + 10)) options.threads.push_back(atoi(t.c_str()));
+    }
+    else if (!strncmp(arg, "--repeat=", 9)) options.repeat = max(1, atoi(arg + 9));
+    else if (!strncmp(arg, "--seed=", 7)) options.seed = atoi(arg + 7);
+    else if (!strncmp(arg, "--processes=", 12)) options.processes = max(1, atoi(arg + 12));
+    else if (!strncmp(arg, "--scaling=", 10)) options.scaling = arg + 10;
+    else if (!strncmp(arg, "--machines=", 11)) {
+      options.machines.clear();
+      for (auto const& m : Split(arg + 11)) options.machines.push_back(strtoull(m.c_str(), nullptr, 10));
+    }
+    else if (!strncmp(arg, "--jobs=", 7)) {
+      options.jobs.clear();
+      for (auto const& n : Split(arg + 7)) options.jobs.push_back(strtoull(n.c_str(), nullptr, 10));
+    }
+    else {
+      Usage(argv[0]);
+      return 1;
+    }
+  }
+  if (options.threads.empty()) {
+    options.threads.push_back(1);
+    if (omp_get_max_threads() > 1) options.threads.push_back(omp_get_max_threads());
+  }
+
+  verbose = false;
+
+  if (!options.scaling.empty()) {
+    BenchScaling(options);
+    return 0;
+  }
+
+  printf("%-20s %3s %-9s %-9s %3s %10s %10s %10s %10s %9s  %s\n",
+    "rounding", "dim", "input", "engine", "thr", "min ms", "mean ms", "Mentries/s", "changed", "maxrss MB", "diff");
+
+  auto selected = [&options](const string& name, int dim) {
+    if (!options.roundings.empty()) {
+      return find(options.roundings.begin(), options.roundings.end(), name) != options.roundings.end();
+    }
+    return dim <= 6 && any_of(BDJR::Roundings().begin(), BDJR::Roundings().end(),
+      [&name](const BDJR::RoundingInfo& r) { return name == r.name; });
+  };
+#define BENCH_ROUNDING(R) \
+  if (selected(RoundingName<R>::Get(), R::Dim())) { \
+    BenchRounding<R>(RoundingName<R>::Get().c_str(), options); \
+  }
+  ROUNDINGS_LIST(BENCH_ROUNDING)
+
+  return 0;
+}
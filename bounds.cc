@@ -0,0 +1,84 @@
+#include <algorithm>
+#include <vector>
+
+#include "bounds.h"
+
+using namespace PCmax;
+
+nat Bounds::Generalized(const Instance& I) {
+  nat l = PCmax::LowerBound(I);
+  nat m = I.GetM();
+  nat n = I.GetN();
+  if (m == 0 || n <= m) return l;
+
+  // run-length table in decreasing order: first[r] = index (0-based) of the
+  // first job of run r, sum[r] = total size of the runs before r
+  auto const& map = I.GetMap();
+  std::vector<nat> p, first, sum;
+  nat k = 0, P = 0;
+  for (auto i = map.rbegin(); i != map.rend(); ++i) {
+    p.push_back(i->first);
+    first.push_back(k);
+    sum.push_back(P);
+    k += i->second;
+    P += i->first * i->second;
+  }
+
+  // total size of the i largest jobs
+  auto Prefix = [&](nat i) {
+    nat r = std::upper_bound(first.begin(), first.end(), i) - first.begin() - 1;
+    return sum[r] + (i - first[r]) * p[r];
+  };
+
+  for (nat k = 1; k*m + 1 <= n; ++k) {
+    // p_{km-k+1} + ... + p_{km+1} in 1-based indices
+    nat L = Prefix(k*m + 1) - Prefix(k*m - k);
+    if (L > l) l = L;
+  }
+  return l;
+}
+
+nat Bounds::BinPacking(const Instance& I, nat T) {
+  auto const& map = I.GetMap();
+  if (map.empty()) return 0;
+  if (map.rbegin()->first > T) return I.GetN() + 1; // nothing fits
+
+  // increasing sizes with prefix counts and sums
+  std::vector<nat> p, count(1, 0), sum(1, 0);
+  for (auto const& j : map) {
+    p.push_back(j.first);
+    count.push_back(count.back() + j.second);
+    sum.push_back(sum.back() + j.first * j.second);
+  }
+  // number of distinct sizes <= x
+  auto Index = [&](nat x) {
+    return (nat)(std::upper_bound(p.begin(), p.end(), x) - p.begin());
+  };
+
+  nat L2 = 0;
+  nat half = T / 2; // p <= T/2 iff p <= half
+  nat alphas = Index(half);
+  for (nat a = 0; a <= alphas; ++a) {
+    nat alpha = (a == 0) ? 0 : p[a-1];
+    nat i1 = Index(T - alpha), i2 = Index(half), i3 = (a == 0) ? 0 : a-1;
+    // J1: p > T-alpha, J2: T/2 < p <= T-alpha, J3: alpha <= p <= T/2
+    nat n1 = count[p.size()] - count[i1];
+    nat n2 = count[i1] - count[i2];
+    nat s2 = sum[i1] - sum[i2];
+    nat s3 = sum[i2] - sum[i3];
+    nat free = n2*T - s2;
+    nat L = n1 + n2 + (s3 > free ? (s3 - free - 1) / T + 1 : 0);
+    if (L > L2) L2 = L;
+  }
+  return L2;
+}
+
+nat Bounds::LowerBound(const Instance& I, nat u) {
+  nat l = Generalized(I);
+  nat m = I.GetM();
+  while (l < u) {
+    nat T = (l + u) / 2;
+    if (BinPacking(I, T) > m) l = T+1; else u = T;
+  }
+  return l;
+}
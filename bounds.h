@@ -0,0 +1,32 @@
+#ifndef BOUNDS_H_
+#define BOUNDS_H_
+
+#include "pcmax.h"
+
+namespace PCmax {
+
+  namespace Bounds {
+    /*
+     * Some machine runs k+1 of the km+1 largest jobs, hence
+     * C_max >= p_{km-k+1} + ... + p_{km+1} (jobs sorted decreasingly) for
+     * every k with km+1 <= n. Maximum over all k, at least LowerBound(I).
+     */
+    nat Generalized(const Instance& I);
+
+    /*
+     * Martello-Toth bound L2 on the number of bins of capacity T needed
+     * for the jobs of I. T is infeasible if it exceeds m.
+     */
+    nat BinPacking(const Instance& I, nat T);
+
+    /*
+     * The best of the bounds above, given a feasible makespan u. The bin
+     * packing test is bisected between Generalized(I) and u; this is sound
+     * since every T below an infeasible one is infeasible, too.
+     */
+    nat LowerBound(const Instance& I, nat u);
+  }
+
+}
+
+#endif
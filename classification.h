@@ -0,0 +1,102 @@
+#ifndef CLASSIFICATION_H_
+#define CLASSIFICATION_H_
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <map>
+#include <vector>
+
+#include "pcmax.h"
+#include "rounding.h"
+
+namespace PCmax {
+
+/*
+ * Classification of the jobs of an instance for a makespan T as in BDJR:
+ * small (p/T <= eps), huge (p/T >= 1-2*eps) and medium with the class
+ * RoundedIndex<R>(p/T). Since p/(double)T is monotone in p, each of these
+ * predicates holds from an integer cut point on, which is computed once
+ * per T; a job is then classified by integer comparisons only and exactly
+ * as by the predicate on doubles. A JobClasses can be reused for several T
+ * and keeps its buffers.
+ */
+template<class R>
+class JobClasses {
+ public:
+  struct Jobs {
+    nat p;
+    nat a;
+    int j; // class of medium jobs
+  };
+
+  JobClasses(double eps, nat T) {
+    SetMakespan(eps, T);
+  }
+
+  /* Recomputes the cut points for T, the jobs must be classified again. */
+  void SetMakespan(double eps, nat T) {
+    this->T = T;
+    small = Cut(eps, true);
+    huge = Cut(1-2*eps, false);
+    for (int i = 0; i < R::Dim(); ++i) {
+      cut[i] = Cut(R::Size(i) / (double)R::Makespan(), false);
+      order[i] = i;
+    }
+    // RoundedIndex takes the first of the largest sizes not exceeding p
+    std::stable_sort(order.begin(), order.end(), [](int a, int b) { return R::Size(a) > R::Size(b); });
+  }
+
+  /*
+   * Splits the jobs into huge, medium and small ones, each in decreasing
+   * order of p. The classes of the medium jobs are found by walking down
+   * the cut points along with the jobs, so the pass is a merge of the job
+   * sizes with the cut points and takes O(#sizes + R::Dim()) comparisons.
+   */
+  void Classify(const std::map<nat,nat>& jobs) {
+    huge_jobs.clear();
+    medium_jobs.clear();
+    small_jobs.clear();
+    int k = 0;
+    for (auto i = jobs.rbegin(); i != jobs.rend(); ++i) {
+      nat p = i->first;
+      if (p >= huge) huge_jobs.push_back(Jobs{p, i->second, -1});
+      else if (p < small) small_jobs.push_back(Jobs{p, i->second, R::Dim()});
+      else {
+        while (p < cut[order[k]]) ++k; // medium jobs are at least the smallest size
+        medium_jobs.push_back(Jobs{p, i->second, order[k]});
+      }
+    }
+  }
+
+  nat T;
+  nat small;                     // jobs below are small
+  nat huge;                      // jobs from here on are huge
+  std::array<nat, R::Dim()> cut; // smallest job of each class
+
+  std::vector<Jobs> huge_jobs;
+  std::vector<Jobs> medium_jobs;
+  std::vector<Jobs> small_jobs;
+
+  std::vector<std::size_t> skip; // scratch of the huge job pairing
+
+ private:
+  // Smallest p with p/(double)T >= t (> t if strict)
+  nat Cut(double t, bool strict) const {
+    auto holds = [this, t, strict](nat p) {
+      double p1 = p / (double)T;
+      return strict ? p1 > t : p1 >= t;
+    };
+    double x = std::ceil(t * T);
+    nat c = x > 0 ? (nat)x : 0;
+    while (c > 0 && holds(c-1)) --c;
+    while (!holds(c)) ++c;
+    return c;
+  }
+
+  std::array<int, R::Dim()> order; // classes by decreasing size
+};
+
+}
+
+#endif // CLASSIFICATION_H_
@@ -0,0 +1,118 @@
+#include <iostream>
+#include <filesystem>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "pcmax.h"
+
+/*
+ * Sends instance files to a server (sched --socket=PATH) and copies the
+ * responses to stdout. Requests use the PSMF text framing, or the binary
+ * one with --binary (named by the file like the results of sched).
+ */
+
+using namespace PCmax;
+using namespace std;
+
+static bool Send(int fd, const string& data) {
+  size_t sent = 0;
+  while (sent < data.size()) {
+    ssize_t k = write(fd, data.data() + sent, data.size() - sent);
+    if (k <= 0) return false;
+    sent += k;
+  }
+  return true;
+}
+
+static void PutU64(string& data, uint64_t x) {
+  for (int i = 0; i < 8; ++i) data += (char)((x >> (8*i)) & 0xFF);
+}
+
+static string Text(const Instance& I) {
+  string data = to_string(I.GetM()) + "\n" + to_string(I.GetN()) + "\n";
+  for (auto const& j : I.GetMap()) {
+    for (nat k = 0; k < j.second; ++k) data += to_string(j.first) + "\n";
+  }
+  return data;
+}
+
+static string Binary(const string& name, const Instance& I) {
+  string data = "I";
+  PutU64(data, name.size());
+  data += name;
+  PutU64(data, I.GetM());
+  PutU64(data, I.GetMap().size());
+  for (auto const& j : I.GetMap()) {
+    PutU64(data, j.first);
+    PutU64(data, j.second);
+  }
+  return data;
+}
+
+static void Usage(const char* program) {
+  cerr << "Usage: " << program << " --socket=PATH [--binary] files..." << endl;
+}
+
+int main(int argc, const char* argv[]) {
+  const char* path = nullptr;
+  bool binary = false;
+  vector<const char*> files;
+
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    if (!strncmp(arg, "--socket=", 9)) path = arg + 9;
+    else if (!strcmp(arg, "--binary")) binary = true;
+    else if (!strncmp(arg, "--", 2)) {
+      Usage(argv[0]);
+      return 1;
+    }
+    else files.push_back(arg);
+  }
+  if (!path) {
+    Usage(argv[0]);
+    return 1;
+  }
+
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  strncpy(address.sun_path, path, sizeof(address.sun_path) - 1);
+  if (fd < 0 || connect(fd, (sockaddr*)&address, sizeof(address)) < 0) {
+    cerr << "Cannot connect to " << path << endl;
+    return 1;
+  }
+
+  // Responses are read meanwhile, the server blocks once the socket is full
+  thread receiver([fd] {
+    char buffer[1 << 16];
+    ssize_t k;
+    while ((k = read(fd, buffer, sizeof(buffer))) > 0) {
+      fwrite(buffer, 1, k, stdout);
+    }
+  });
+
+  for (const char* file : files) {
+    Instance I;
+    if (!I.Read(file)) {
+      cerr << "Cannot read " << file << endl;
+      continue;
+    }
+    string data = binary ? Binary(filesystem::path(file).stem().string(), I) : Text(I);
+    if (!Send(fd, data)) {
+      cerr << "Cannot send " << file << endl;
+      break;
+    }
+  }
+  shutdown(fd, SHUT_WR); // the server answers the remaining requests and closes
+
+  receiver.join();
+  close(fd);
+  return 0;
+}
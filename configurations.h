@@ -0,0 +1,101 @@
+#ifndef CONFIGURATIONS_H_
+#define CONFIGURATIONS_H_
+
+#include <cstdint>
+
+#include "vector.h"
+
+/*
+ * The vectors Tensor<R>::Initialize() marks around the anchor, computed at
+ * compile time since they only depend on R:
+ *   configurations  non-negative, 1 <= l1 norm <= MaxL1Norm(), volume at
+ *                   most Makespan() - Precision(), every multiset once
+ *   substitutions   -e_i + e_j + e_k with i not in {j, k}, j <= k and
+ *                   volume within +-Precision()
+ * Each entry is sparse: `terms` distinct axes with their coordinates.
+ * Volumes are compared exactly like Vector<R>::ScaledVolume() does.
+ */
+template<class R>
+struct ConfigurationTable {
+  static constexpr int kMaxTerms = R::MaxL1Norm() > 3 ? R::MaxL1Norm() : 3;
+
+  struct Entry {
+    int terms;
+    int axis[kMaxTerms];
+    int delta[kMaxTerms];
+  };
+
+  /* Multisets of 1..MaxL1Norm() axes, C(Dim + MaxL1Norm, MaxL1Norm) - 1 */
+  static constexpr int MaxConfigurations() {
+    std::int64_t c = 1;
+    for (int k = 1; k <= R::MaxL1Norm(); ++k) c = c * (R::Dim() + k) / k;
+    return (int)c - 1;
+  }
+
+  static constexpr int MaxSubstitutions() {
+    return R::Dim() * R::Dim() * (R::Dim() + 1) / 2;
+  }
+
+  int num_configurations;
+  int num_substitutions;
+  Entry configurations[MaxConfigurations()];
+  Entry substitutions[MaxSubstitutions()];
+
+  static constexpr ConfigurationTable Make() {
+    ConfigurationTable table{};
+    const std::int64_t capacity = ScaledSize(R::Makespan() - R::Precision());
+    const std::int64_t precision = ScaledSize(R::Precision());
+
+    // Non-decreasing axis sequences a[0] <= ... <= a[norm-1]
+    for (int norm = 1; norm <= R::MaxL1Norm(); ++norm) {
+      int a[kMaxTerms] = {};
+      while (true) {
+        Entry e{};
+        std::int64_t volume = 0;
+        for (int t = 0; t < norm; ++t) {
+          volume += ScaledSize(R::Size(a[t]));
+          if (t > 0 && a[t] == a[t-1]) {
+            ++e.delta[e.terms - 1];
+          } else {
+            e.axis[e.terms] = a[t];
+            e.delta[e.terms] = 1;
+            ++e.terms;
+          }
+        }
+        if (volume <= capacity) table.configurations[table.num_configurations++] = e;
+
+        int t = norm - 1;
+        while (t >= 0 && a[t] == R::Dim() - 1) --t;
+        if (t < 0) break;
+        ++a[t];
+        for (int u = t + 1; u < norm; ++u) a[u] = a[t];
+      }
+    }
+
+    for (int i = 0; i < R::Dim(); ++i) {
+      for (int j = 0; j < R::Dim(); ++j) {
+        for (int k = j; k < R::Dim(); ++k) {
+          if (i == j || i == k) continue;
+          std::int64_t volume = ScaledSize(R::Size(j)) + ScaledSize(R::Size(k)) - ScaledSize(R::Size(i));
+          if (volume < -precision || volume > precision) continue;
+          Entry e{};
+          e.axis[e.terms] = i;
+          e.delta[e.terms++] = -1;
+          e.axis[e.terms] = j;
+          e.delta[e.terms++] = j == k ? 2 : 1;
+          if (j != k) {
+            e.axis[e.terms] = k;
+            e.delta[e.terms++] = 1;
+          }
+          table.substitutions[table.num_substitutions++] = e;
+        }
+      }
+    }
+    return table;
+  }
+};
+
+template<class R>
+inline constexpr ConfigurationTable<R> kConfigurationTable = ConfigurationTable<R>::Make();
+
+#endif // CONFIGURATIONS_H_
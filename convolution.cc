@@ -1,18 +1,30 @@
+#include <array>
 #include <complex>
-#include <fftw3.h>
+#include <cstring>
+#include <new>
+#include <cstdint>
+#include <vector>
+#include <algorithm>
 #include <omp.h>
 
 #include "convolution.h"
 
 #include "rounding.h"
+#include "fft.h"
+#include "shard.h"
+#include "memory.h"
+#include "interrupt.h"
+#include "log.h"
 
 template<class R>
-void NaiveConvolution<R>::Square(Tensor<R>& target, const Tensor<R>& source, const Vector<R>& target_anchor, const Vector<R>& source_anchor) {
+std::size_t NaiveConvolution<R>::Square(Tensor<R>& target, const Tensor<R>& source, const Vector<R>& target_anchor, const Vector<R>& source_anchor) {
   Vector<R> a;
   Vector<R> b;
   target.Reset();
 
+  const std::atomic_bool& stop = Interrupt::Flag();
   for (std::size_t i = 0; i < Tensor<R>::data_size(); ++i) {
+    if (stop.load(std::memory_order_relaxed)) return 0;
     Tensor<R>::FromIndex(a, i);
     int va = source.Get(a);
     if (va == -1) continue;
@@ -35,12 +47,20 @@ void NaiveConvolution<R>::Square(Tensor<R>& target, const Tensor<R>& source, con
       }
     }
   }
+
+  std::size_t changed = 0;
+  for (std::size_t i = 0; i < Tensor<R>::data_size(); ++i) {
+    if (target.data_unsafe()[i] != source.data_unsafe()[i]) ++changed;
+  }
+  return changed;
 }
 
 template<class R>
-void ParallelNaiveConvolution<R>::Square(Tensor<R>& target, const Tensor<R>& source, const Vector<R>& target_anchor, const Vector<R>& source_anchor) {
-  std::cout << "parallel convolution " << Tensor<R>::data_size() << std::endl;
-  #pragma omp parallel
+std::size_t ParallelNaiveConvolution<R>::Square(Tensor<R>& target, const Tensor<R>& source, const Vector<R>& target_anchor, const Vector<R>& source_anchor) {
+  LOG << "parallel convolution " << Tensor<R>::data_size() << std::endl;
+  const std::atomic_bool& stop = Interrupt::Flag();
+  std::size_t changed = 0;
+  #pragma omp parallel reduction(+:changed)
   {
     Vector<R> a;
     Vector<R> a2;
@@ -50,6 +70,7 @@ void ParallelNaiveConvolution<R>::Square(Tensor<R>& target, const Tensor<R>& sou
 
     #pragma omp for
     for (size_t i = 0; i < Tensor<R>::data_size(); ++i) {
+      if (stop.load(std::memory_order_relaxed)) continue;
       Tensor<R>::FromIndex(a, i);
 
       // This optimization cuts the search space down slightly
@@ -85,131 +106,627 @@ void ParallelNaiveConvolution<R>::Square(Tensor<R>& target, const Tensor<R>& sou
         }
       }
       target.Set(a, va);
+      if (va != source.data_unsafe()[i]) ++changed;
     }
   }
+  return changed;
 }
 
+/*
+ * Value of the empty classes in ConvolveValueClasses meaning "any value".
+ */
+static constexpr int kAnyValue = -2;
+
+/*
+ * Computes the cyclic convolution of the indicators of the source entries
+ * with values m and m_ on the padded grid into buf (buf_ is scratch). source
+ * holds the source values and idx their positions on the padded grid.
+ */
 template<class R>
-void FFTConvolution<R>::Square(Tensor<R>& target, const Tensor<R>& source, const Vector<R>& target_anchor, const Vector<R>& source_anchor) {
+static void ConvolveValueClasses(const std::atomic_int* source, const std::vector<unsigned>& idx, int m, int m_,
+  std::complex<float>* buf, std::complex<float>* buf_, fftwf_plan plan_forward, fftwf_plan plan_backward) {
   const std::size_t n = Tensor<CheapPaddedRounding<R>>::data_size();
-  std::atomic_int m_max, m_min;
-  m_min = 9999999;
-  m_max = -1;
-  #pragma omp parallel for
+  auto in_class = [](int v, int m) { return m == kAnyValue ? v != -1 : v == m; };
+
+  std::fill(buf, buf+n, std::complex<float>{});
+  if (m != m_) std::fill(buf_, buf_+n, std::complex<float>{});
+
   for (std::size_t i = 0; i < Tensor<R>::data_size(); ++i) {
-    Vector<R> c;
-    Tensor<R>::FromIndex(c, i);
-    int v = source.Get(c);
-    int cur = m_max;
-    while (v != -1 && v > cur) {
-      if (std::atomic_compare_exchange_weak(&m_max, &cur, v)) {
-        break;
-      }
+    int v = source[i];
+    if (in_class(v, m)) {
+      buf[idx[i]].real(1.0f / (float)n);
     }
-    while (v != -1 && v < cur) {
-      if (std::atomic_compare_exchange_weak(&m_min, &cur, v)) {
-        break;
-      }
+    if (m != m_ && in_class(v, m_)) {
+      buf_[idx[i]].real(1.0f);
     }
   }
-  target.Reset();
 
-  int combinations = (m_max - m_min + 1) * (m_max - m_min + 2) / 2;
+  fftwf_execute_dft(plan_forward, (fftwf_complex*)buf, (fftwf_complex*)buf);
+  if (m != m_) {
+    fftwf_execute_dft(plan_forward, (fftwf_complex*)buf_, (fftwf_complex*)buf_);
+    for (std::size_t i = 0; i < n; ++i) {
+      buf[i] *= buf_[i];
+    }
+  } else {
+    for (std::size_t i = 0; i < n; ++i) {
+      buf[i] *= buf[i] * (float)n;
+    }
+  }
+
+  fftwf_execute_dft(plan_backward, (fftwf_complex*)buf, (fftwf_complex*)buf);
+}
+
+/*
+ * The value classes of a source tensor: pairs m_ <= m of non-empty classes
+ * in increasing order of m + m_, where pairs[group[g]] to
+ * pairs[group[g+1]-1] have the sum 2*m_min + g, and the positions of the
+ * source and of the shifted target entries on the padded grid.
+ */
+template<class R>
+struct ValueClasses {
+  int m_min, m_max;
+  std::size_t finite; // entries != -1
+  std::vector<std::pair<int,int>> pairs;
+  std::vector<std::size_t> group;
+  std::vector<unsigned> source_idx, target_idx;
+
+  /* False if the source has no finite entry. */
+  bool Prepare(const std::atomic_int* values, const Vector<R>& target_anchor, const Vector<R>& source_anchor) {
+    m_max = -1;
+    m_min = 9999999;
+    #pragma omp parallel for reduction(max:m_max) reduction(min:m_min)
+    for (std::size_t i = 0; i < Tensor<R>::data_size(); ++i) {
+      int v = values[i];
+      if (v == -1) continue;
+      if (v > m_max) m_max = v;
+      if (v < m_min) m_min = v;
+    }
+    if (m_max == -1) return false; // nothing to combine
+
+    std::vector<std::size_t> count(m_max - m_min + 1);
+    for (std::size_t i = 0; i < Tensor<R>::data_size(); ++i) {
+      int v = values[i];
+      if (v != -1) ++count[v - m_min];
+    }
+    finite = 0;
+    for (std::size_t c : count) finite += c;
 
-  int deviations[R::Dim()];
-  for (std::size_t i = 0; i < R::Dim(); ++i) {
-    deviations[i] = CheapPaddedRounding<R>::Deviation(i);
+    for (int sum = 2*m_min; sum <= 2*m_max; ++sum) {
+      group.push_back(pairs.size());
+      for (int m_ = std::max(m_min, sum - m_max); 2*m_ <= sum; ++m_) {
+        int m = sum - m_;
+        if (count[m - m_min] > 0 && count[m_ - m_min] > 0) pairs.emplace_back(m, m_);
+      }
+    }
+    group.push_back(pairs.size());
+
+    source_idx.resize(Tensor<R>::data_size());
+    target_idx.resize(Tensor<R>::data_size());
+    #pragma omp parallel for
+    for (std::size_t i = 0; i < Tensor<R>::data_size(); ++i) {
+      Vector<R> a;
+      Vector<CheapPaddedRounding<R>> padded;
+      Tensor<R>::FromIndex(a, i);
+      for (int k = 0; k < R::Dim(); ++k) padded[k] = a[k];
+      source_idx[i] = Tensor<CheapPaddedRounding<R>>::ToIndex(padded);
+      a += target_anchor;
+      a -= source_anchor;
+      a -= source_anchor;
+      for (int k = 0; k < R::Dim(); ++k) padded[k] = a[k];
+      target_idx[i] = Tensor<CheapPaddedRounding<R>>::ToIndex(padded);
+    }
+    return true;
   }
+};
+
+/*
+ * Min-plus square through cyclic convolutions of the value classes on the
+ * padded grid. T provides the buffer Element type, Convolve (like
+ * ConvolveValueClasses) and Reached, which tells whether an element of the
+ * result counts at least one pair.
+ */
+template<class R, class T>
+static std::size_t SquareByValueClasses(Tensor<R>& target, const Tensor<R>& source, const Vector<R>& target_anchor, const Vector<R>& source_anchor) {
+  typedef typename T::Element Element;
+  const std::size_t n = Tensor<CheapPaddedRounding<R>>::data_size();
+  const std::atomic_int* values = source.data_unsafe();
+  ValueClasses<R> classes;
+  target.Reset();
+  if (!classes.Prepare(values, target_anchor, source_anchor)) return 0;
+  const int m_min = classes.m_min;
+  const auto& pairs = classes.pairs;
+  const auto& group = classes.group;
+  const auto& source_idx = classes.source_idx;
+  const auto& target_idx = classes.target_idx;
+
+  // Entries reachable by any pair that are still unset. Once it drops to zero,
+  // the remaining (larger) sums cannot improve anything.
+  std::atomic<std::size_t> open(0);
+  bool done = false;
 
-  fftwf_plan plan_forward = fftwf_plan_dft(R::Dim(), deviations, 0, 0, FFTW_FORWARD, FFTW_ESTIMATE);
-  fftwf_plan plan_backward = fftwf_plan_dft(R::Dim(), deviations, 0, 0, FFTW_BACKWARD, FFTW_ESTIMATE);
+  // Written entries whose value differs from the source entry, and written
+  // entries which are set in the source. The others that differ are set in
+  // the source but not in the target.
+  std::size_t changed = 0, covered = 0;
+  const std::size_t finite = classes.finite;
 
-  #pragma omp parallel num_threads(15)
+  const std::atomic_bool& stop = Interrupt::Flag();
+  #pragma omp parallel num_threads(std::min(15, omp_get_max_threads())) reduction(+:changed, covered)
   {
-    Vector<R> a, b;
-    a.Reset();
-    std::complex<float>* fftw_in = (std::complex<float>*)fftwf_malloc(n * sizeof(std::complex<float>));
-    std::complex<float>* fftw_in_ = (std::complex<float>*)fftwf_malloc(n * sizeof(std::complex<float>));
-    #pragma omp for
-    for (int iter = 0; iter < combinations; ++iter) {
-      int remainder = iter;
-      int m = m_min;
-      int m_ = m_min;
-      while (remainder-- > 0) {
-        if (m <= m_) {
-          m++;
-          m_ = m_min;
-        }
-        else {
-          m_++;
-        }
-      }
-      
-      std::fill(fftw_in, fftw_in+n, std::complex<float>{});
-      std::fill(fftw_in_, fftw_in_+n, std::complex<float>{});
+    Element* buf = (Element*)Memory::Allocate(n * sizeof(Element));
+    Element* buf_ = (Element*)Memory::Allocate(n * sizeof(Element));
 
+    #pragma omp single
+    {
+      T::Convolve(values, source_idx, kAnyValue, kAnyValue, buf, buf_);
+      std::size_t reachable = 0;
       for (std::size_t i = 0; i < Tensor<R>::data_size(); ++i) {
-        Tensor<R>::FromIndex(a, i);
-        int v = source.Get(a);
-        int idx = Tensor<CheapPaddedRounding<R>>::ToIndex(reinterpret_cast<Vector<CheapPaddedRounding<R>>&>(a));
-        if (m == v) {
-          fftw_in[idx].real(1.0f / (float)n);
-        }
-        if (m_ == v) {
-          fftw_in_[idx].real(1.0f);
+        if (T::Reached(buf[target_idx[i]])) ++reachable;
+      }
+      open = reachable;
+      done = reachable == 0;
+    }
+
+    for (std::size_t g = 0; g + 1 < group.size() && !done; ++g) {
+      const int sum = 2*m_min + g;
+
+      #pragma omp for schedule(dynamic)
+      for (std::size_t k = group[g]; k < group[g+1]; ++k) {
+        if (stop.load(std::memory_order_relaxed)) continue;
+
+        T::Convolve(values, source_idx, pairs[k].first, pairs[k].second, buf, buf_);
+
+        // Smaller sums were completed before, so only unset entries can change
+        std::size_t set = 0;
+        for (std::size_t i = 0; i < Tensor<R>::data_size(); ++i) {
+          if (target.data_unsafe()[i] != -1 || !T::Reached(buf[target_idx[i]])) continue;
+          int v = -1;
+          if (std::atomic_compare_exchange_strong(&target.data_unsafe()[i], &v, sum)) {
+            ++set;
+            int s = values[i];
+            if (s != sum) ++changed;
+            if (s != -1) ++covered;
+          }
         }
+        open -= set;
+      }
+
+      #pragma omp single
+      done = open == 0 || stop.load(std::memory_order_relaxed);
+    }
+
+    Memory::Free(buf, n * sizeof(Element));
+    Memory::Free(buf_, n * sizeof(Element));
+  }
+  return changed + (finite - covered);
+}
+
+template<class R>
+struct FloatTransform {
+  typedef std::complex<float> Element;
+
+  static void Convolve(const std::atomic_int* source, const std::vector<unsigned>& idx, int m, int m_, Element* buf, Element* buf_) {
+    const FFT::Plans& plans = FFT::PlansOf<CheapPaddedRounding<R>>();
+    ConvolveValueClasses<R>(source, idx, m, m_, buf, buf_, plans.forward, plans.backward);
+  }
+
+  static bool Reached(const Element& x) {
+    return x.real() > 0.5;
+  }
+};
+
+template<class R>
+std::size_t FFTConvolution<R>::Square(Tensor<R>& target, const Tensor<R>& source, const Vector<R>& target_anchor, const Vector<R>& source_anchor) {
+  return SquareByValueClasses<R, FloatTransform<R>>(target, source, target_anchor, source_anchor);
+}
+
+/*
+ * Shared segment of ShardedFFTConvolution: the header, the source values
+ * and the target, which the workers lower by compare-and-swap.
+ */
+struct ShardHeader {
+  std::atomic<std::size_t> next; // next pair to take
+  std::atomic<std::size_t> open; // reachable target entries that are unset
+  std::atomic_int stop;
+};
+
+template<class R>
+std::size_t ShardedFFTConvolution<R>::Square(Tensor<R>& target, const Tensor<R>& source, const Vector<R>& target_anchor, const Vector<R>& source_anchor) {
+  static_assert(std::atomic_int::is_always_lock_free && std::atomic<std::size_t>::is_always_lock_free,
+    "atomics in shared memory have to be lock free");
+  typedef FloatTransform<R> T;
+  typedef typename T::Element Element;
+  const std::size_t N = Tensor<R>::data_size();
+  const std::size_t n = Tensor<CheapPaddedRounding<R>>::data_size();
+
+  if (Shard::Processes() <= 0) return FFTConvolution<R>::Square(target, source, target_anchor, source_anchor);
+
+  ValueClasses<R> classes;
+  if (!classes.Prepare(source.data_unsafe(), target_anchor, source_anchor)) {
+    target.Reset();
+    return 0;
+  }
+
+  Shard::Segment segment;
+  const std::size_t header_size = (sizeof(ShardHeader) + 63) / 64 * 64;
+  if (!Shard::Create(segment, header_size + 2 * N * sizeof(std::atomic_int))) {
+    LOG << "no shared memory, FFT in this process" << std::endl;
+    return FFTConvolution<R>::Square(target, source, target_anchor, source_anchor);
+  }
+  ShardHeader* header = new (segment.data) ShardHeader();
+  std::atomic_int* values = reinterpret_cast<std::atomic_int*>((char*)segment.data + header_size);
+  std::atomic_int* shared = values + N;
+  for (std::size_t i = 0; i < N; ++i) {
+    new (&values[i]) std::atomic_int(source.data_unsafe()[i].load(std::memory_order_relaxed));
+    new (&shared[i]) std::atomic_int(-1);
+  }
+
+  // Plans and the number of reachable entries before the workers start
+  {
+    Element* buf = (Element*)Memory::Allocate(n * sizeof(Element));
+    Element* buf_ = (Element*)Memory::Allocate(n * sizeof(Element));
+    T::Convolve(values, classes.source_idx, kAnyValue, kAnyValue, buf, buf_);
+    std::size_t reachable = 0;
+    for (std::size_t i = 0; i < N; ++i) {
+      if (T::Reached(buf[classes.target_idx[i]])) ++reachable;
+    }
+    header->open = reachable;
+    Memory::Free(buf, n * sizeof(Element));
+    Memory::Free(buf_, n * sizeof(Element));
+  }
+
+  // Pairs are taken in increasing order of their sums. Once every reachable
+  // entry is set, the pairs not taken yet have sums at least as large as
+  // all entries, so only the pairs in progress are completed.
+  bool ok = Shard::Run([&](int) {
+    Element* buf = (Element*)Memory::Allocate(n * sizeof(Element));
+    Element* buf_ = (Element*)Memory::Allocate(n * sizeof(Element));
+    while (!header->stop.load(std::memory_order_relaxed) && header->open > 0) {
+      std::size_t k = header->next++;
+      if (k >= classes.pairs.size()) break;
+      const int sum = classes.pairs[k].first + classes.pairs[k].second;
+
+      T::Convolve(values, classes.source_idx, classes.pairs[k].first, classes.pairs[k].second, buf, buf_);
+
+      std::size_t set = 0;
+      for (std::size_t i = 0; i < N; ++i) {
+        if (!T::Reached(buf[classes.target_idx[i]])) continue;
+        int v = shared[i].load(std::memory_order_relaxed);
+        while ((v == -1 || sum < v) && !shared[i].compare_exchange_weak(v, sum)) {}
+        if (v == -1) ++set;
       }
+      header->open -= set;
+    }
+    Memory::Free(buf, n * sizeof(Element));
+    Memory::Free(buf_, n * sizeof(Element));
+  }, header->stop);
+
+  if (!ok && !Interrupt::Requested()) {
+    Shard::Destroy(segment);
+    std::cerr << "FFT worker failed, FFT in this process" << std::endl;
+    return FFTConvolution<R>::Square(target, source, target_anchor, source_anchor);
+  }
+
+  std::size_t changed = 0;
+  #pragma omp parallel for reduction(+:changed)
+  for (std::size_t i = 0; i < N; ++i) {
+    int v = shared[i].load(std::memory_order_relaxed);
+    target.data_unsafe()[i].store(v, std::memory_order_relaxed);
+    if (v != source.data_unsafe()[i]) ++changed;
+  }
+  Shard::Destroy(segment);
+  return changed;
+}
+
+/*
+ * Arithmetic modulo the prime p = 45 * 2^24 + 1 with Montgomery
+ * multiplication, MulMod(a, b) = a * b / 2^32 mod p. Since 9 divides p - 1,
+ * there are length 9 transforms for the padded axes. Every cyclic
+ * convolution value is a number of pairs, at most 6^Dim < p, so it is zero
+ * modulo p if and only if it is zero. Factors that are powers of 2 (of
+ * Montgomery multiplications and of the missing 1/n) do not change that.
+ */
+static constexpr std::uint32_t kPrime = 754974721;
+static constexpr std::uint32_t kPrimitiveRoot = 11;
+
+static constexpr std::uint32_t NegativeInverse() {
+  std::uint32_t x = 1; // Newton iteration for p^-1 mod 2^32
+  for (int i = 0; i < 5; ++i) x *= 2 - kPrime * x;
+  return -x;
+}
+static constexpr std::uint32_t kNegativeInverse = NegativeInverse();
+
+static inline std::uint32_t MulMod(std::uint32_t a, std::uint32_t b) {
+  std::uint64_t t = (std::uint64_t)a * b;
+  std::uint32_t q = (std::uint32_t)t * kNegativeInverse;
+  std::uint32_t u = (t + (std::uint64_t)q * kPrime) >> 32;
+  return u >= kPrime ? u - kPrime : u;
+}
+
+static inline std::uint32_t AddMod(std::uint32_t a, std::uint32_t b) {
+  std::uint32_t s = a + b;
+  return s >= kPrime ? s - kPrime : s;
+}
+
+static constexpr std::uint32_t PowMod(std::uint64_t b, std::uint64_t e) {
+  std::uint64_t r = 1;
+  for (b %= kPrime; e > 0; e >>= 1, b = b * b % kPrime) {
+    if (e & 1) r = r * b % kPrime;
+  }
+  return r;
+}
 
-      fftwf_execute_dft(plan_forward, (fftwf_complex*)fftw_in, (fftwf_complex*)fftw_in);
-      fftwf_execute_dft(plan_forward, (fftwf_complex*)fftw_in_, (fftwf_complex*)fftw_in_);
+/*
+ * Powers of a 9th root of unity (inverse: of its inverse) in Montgomery form,
+ * so that MulMod by them multiplies by the plain power.
+ */
+static std::array<std::uint32_t, 9> RootsOfUnity(bool inverse) {
+  std::uint64_t w = PowMod(kPrimitiveRoot, (kPrime - 1) / 9);
+  if (inverse) w = PowMod(w, 8);
+  std::array<std::uint32_t, 9> roots;
+  for (int k = 0; k < 9; ++k) roots[k] = ((std::uint64_t)PowMod(w, k) << 32) % kPrime;
+  return roots;
+}
+
+static inline std::uint32_t SubMod(std::uint32_t a, std::uint32_t b) {
+  return a >= b ? a - b : a + kPrime - b;
+}
+
+/*
+ * DFT of length 3 with the cube root of unity w3: since w3^2 = -1 - w3, it
+ * needs only one multiplication.
+ */
+static inline void Dft3(std::uint32_t& a, std::uint32_t& b, std::uint32_t& c, std::uint32_t w3) {
+  std::uint32_t t = MulMod(SubMod(b, c), w3);
+  std::uint32_t y0 = AddMod(AddMod(a, b), c);
+  std::uint32_t y1 = AddMod(SubMod(a, c), t);
+  std::uint32_t y2 = SubMod(SubMod(a, b), t);
+  a = y0;
+  b = y1;
+  c = y2;
+}
+
+/*
+ * Length 9 DFTs (as 3 x 3 Cooley-Tukey) of the width lines a[x*step + j*s],
+ * j < 9, for x < width, vectorized over x.
+ */
+static inline void Dft9(std::uint32_t* a, std::size_t s, std::size_t step, std::size_t width, const std::array<std::uint32_t, 9>& w) {
+  const std::uint32_t w1 = w[1], w2 = w[2], w3 = w[3], w4 = w[4];
+  #pragma omp simd
+  for (std::size_t x = 0; x < width; ++x) {
+    std::uint32_t* l = a + x*step;
+    std::uint32_t y[9];
+    for (int j = 0; j < 9; ++j) y[j] = l[j*s];
+    // inner DFTs over j1 for j = 3*j1 + j2, then twiddles w^(j2*k1)
+    Dft3(y[0], y[3], y[6], w3);
+    Dft3(y[1], y[4], y[7], w3);
+    Dft3(y[2], y[5], y[8], w3);
+    y[4] = MulMod(y[4], w1);
+    y[7] = MulMod(y[7], w2);
+    y[5] = MulMod(y[5], w2);
+    y[8] = MulMod(y[8], w4);
+    // outer DFTs over j2, the output k1 + 3*k2 is in y[3*k1 + k2]
+    Dft3(y[0], y[1], y[2], w3);
+    Dft3(y[3], y[4], y[5], w3);
+    Dft3(y[6], y[7], y[8], w3);
+    for (int k1 = 0; k1 < 3; ++k1) {
+      for (int k2 = 0; k2 < 3; ++k2) l[(k1 + 3*k2)*s] = y[3*k1 + k2];
+    }
+  }
+}
 
-      for (std::size_t i = 0; i < Tensor<CheapPaddedRounding<R>>::data_size(); ++i) {
-        fftw_in[i] *= fftw_in_[i];
+template<class R>
+struct ModularTransform {
+  typedef std::uint32_t Element;
+
+  static void Transform(Element* a, bool inverse) {
+    static_assert(CheapPaddedRounding<R>::Deviation(0) == 9, "axes of length 9 only");
+    static_assert(Tensor<R>::data_size() < kPrime, "counts are not exact modulo p");
+    static const std::array<std::uint32_t, 9> forward = RootsOfUnity(false);
+    static const std::array<std::uint32_t, 9> backward = RootsOfUnity(true);
+    const std::array<std::uint32_t, 9>& w = inverse ? backward : forward;
+    const std::size_t lines = Tensor<CheapPaddedRounding<R>>::data_size() / 9;
+    constexpr std::size_t kWidth = 81;
+
+    // axis 0: the lines are contiguous, batch them
+    for (std::size_t line = 0; line < lines; line += kWidth) {
+      Dft9(a + 9*line, 1, 9, std::min(kWidth, lines - line), w);
+    }
+    // other axes: neighbouring lines are contiguous
+    std::size_t s = 9;
+    for (int i = 1; i < R::Dim(); ++i, s *= 9) {
+      const std::size_t width = std::min(s, kWidth);
+      for (std::size_t line = 0; line < lines; line += width) {
+        Dft9(a + line / s * 9 * s + line % s, s, 1, width, w);
       }
+    }
+  }
 
-      fftwf_execute_dft(plan_backward, (fftwf_complex*)fftw_in, (fftwf_complex*)fftw_in);
+  static void Convolve(const std::atomic_int* source, const std::vector<unsigned>& idx, int m, int m_, Element* buf, Element* buf_) {
+    const std::size_t n = Tensor<CheapPaddedRounding<R>>::data_size();
+    auto in_class = [](int v, int m) { return m == kAnyValue ? v != -1 : v == m; };
 
-      for (std::size_t i = 0; i < Tensor<R>::data_size(); ++i) {
-        Tensor<R>::FromIndex(a, i);
-        a += target_anchor;
-        a -= source_anchor;
-        a -= source_anchor;
-        int idx = Tensor<CheapPaddedRounding<R>>::ToIndex(reinterpret_cast<Vector<CheapPaddedRounding<R>>&>(a));
-        int v = target.data_unsafe()[i];
-        if (fftw_in[idx].real() > 0.5) {
-          while (v == -1 || v > m + m_) {
-            if (std::atomic_compare_exchange_weak(&target.data_unsafe()[i], &v, m + m_)) {
-              break;
-            }
+    std::fill(buf, buf+n, 0);
+    if (m != m_) std::fill(buf_, buf_+n, 0);
+    for (std::size_t i = 0; i < Tensor<R>::data_size(); ++i) {
+      int v = source[i];
+      if (in_class(v, m)) buf[idx[i]] = 1;
+      if (m != m_ && in_class(v, m_)) buf_[idx[i]] = 1;
+    }
+
+    Transform(buf, false);
+    if (m != m_) {
+      Transform(buf_, false);
+      #pragma omp simd
+      for (std::size_t i = 0; i < n; ++i) buf[i] = MulMod(buf[i], buf_[i]);
+    } else {
+      #pragma omp simd
+      for (std::size_t i = 0; i < n; ++i) buf[i] = MulMod(buf[i], buf[i]);
+    }
+    Transform(buf, true);
+  }
+
+  static bool Reached(Element x) {
+    return x != 0;
+  }
+};
+
+template<class R>
+std::size_t NTTConvolution<R>::Square(Tensor<R>& target, const Tensor<R>& source, const Vector<R>& target_anchor, const Vector<R>& source_anchor) {
+  return SquareByValueClasses<R, ModularTransform<R>>(target, source, target_anchor, source_anchor);
+}
+
+template<class R>
+std::size_t BlockedConvolution<R>::Square(Tensor<R>& target, const Tensor<R>& source, const Vector<R>& target_anchor, const Vector<R>& source_anchor) {
+  constexpr int D = R::Dim();
+  constexpr std::size_t N = Tensor<R>::data_size();
+  constexpr int kInf = 1 << 29; // -1 entries, kInf + kInf does not overflow
+  constexpr std::size_t kBlockBytes = 1 << 15;
+
+  std::size_t stride[D+1];
+  stride[0] = 1;
+  for (int i = 0; i < D; ++i) stride[i+1] = stride[i] * R::Deviation(i);
+
+  // a + d = b + c for target entries a and source entries b, c
+  Vector<R> d = target_anchor;
+  d -= source_anchor;
+  d -= source_anchor;
+
+  std::vector<int> values(N);
+  std::vector<std::pair<Vector<R>,int>> support;
+  for (std::size_t i = 0; i < N; ++i) {
+    int v = source.data_unsafe()[i];
+    values[i] = v == -1 ? kInf : v;
+    if (v != -1) {
+      Vector<R> b;
+      Tensor<R>::FromIndex(b, i);
+      support.emplace_back(b, v);
+    }
+  }
+
+  // A block holds the entries with the same coordinates k, ..., D-1
+  const std::size_t min_blocks = 4 * omp_get_max_threads();
+  int k = D;
+  while (k > 0 && (stride[k] * sizeof(int) > kBlockBytes || N / stride[k] < min_blocks)) --k;
+  const std::size_t block = stride[k];
+
+  const std::atomic_bool& stop = Interrupt::Flag();
+  std::size_t changed = 0;
+  #pragma omp parallel reduction(+:changed)
+  {
+    std::vector<int> t(block);
+    int lo[D] = {}, hi[D] = {}, a[D] = {};
+
+    #pragma omp for schedule(dynamic)
+    for (std::size_t first = 0; first < N; first += block) {
+      if (stop.load(std::memory_order_relaxed)) continue;
+      std::fill(t.begin(), t.end(), kInf);
+
+      for (const auto& entry : support) {
+        const Vector<R>& b = entry.first;
+        const int vb = entry.second;
+
+        // Valid range of a[i] such that c[i] = a[i] + d[i] - b[i] is within deviation
+        bool empty = false;
+        std::ptrdiff_t offset = 0; // index of c minus index of a
+        for (int i = 0; i < D; ++i) {
+          offset += (std::ptrdiff_t)(d[i] - b[i]) * (std::ptrdiff_t)stride[i];
+          lo[i] = std::max(0, b[i] - d[i]);
+          hi[i] = std::min(R::Deviation(i), b[i] - d[i] + R::Deviation(i));
+          if (i >= k) { // fixed within the block
+            int ai = (first / stride[i]) % R::Deviation(i);
+            if (ai < lo[i] || ai >= hi[i]) empty = true;
+            lo[i] = ai;
+            hi[i] = ai + 1;
           }
+          empty = empty || lo[i] >= hi[i];
         }
+        if (empty) continue;
+
+        // Leading dimensions with full range form one contiguous strip
+        int j = 0;
+        while (j < k && lo[j] == 0 && hi[j] == R::Deviation(j)) ++j;
+        const std::size_t len = j < k ? stride[j] * (hi[j] - lo[j]) : block;
+
+        for (int i = j; i < k; ++i) a[i] = lo[i];
+        while (true) {
+          std::size_t base = 0;
+          for (int i = j; i < k; ++i) base += a[i] * stride[i];
+          int* tp = t.data() + base;
+          const int* sp = values.data() + first + base + offset;
+          #pragma omp simd
+          for (std::size_t x = 0; x < len; ++x) {
+            int v = vb + sp[x];
+            tp[x] = v < tp[x] ? v : tp[x];
+          }
+
+          // Next strip: odometer over the dimensions j+1, ..., k-1
+          int i = j + 1;
+          while (i < k && ++a[i] == hi[i]) {
+            a[i] = lo[i];
+            ++i;
+          }
+          if (i >= k) break;
+        }
+      }
+
+      for (std::size_t x = 0; x < block; ++x) {
+        int v = t[x] >= kInf ? -1 : t[x];
+        target.data_unsafe()[first + x] = v;
+        if (v != source.data_unsafe()[first + x]) ++changed;
       }
     }
-    fftwf_free(fftw_in);
-    fftwf_free(fftw_in_);
   }
-  fftwf_destroy_plan(plan_forward);
-  fftwf_destroy_plan(plan_backward);
+  return changed;
+}
+
+template<class R>
+std::size_t AutoConvolution<R>::Square(Tensor<R>& target, const Tensor<R>& source, const Vector<R>& target_anchor, const Vector<R>& source_anchor) {
+  // Direct work per finite source entry is one pass over the target
+  constexpr std::size_t kMaxDirectWork = std::size_t(1) << 32;
+  if (R::Dim() > 5) {
+    std::size_t support = 0;
+    #pragma omp parallel for reduction(+:support)
+    for (std::size_t i = 0; i < Tensor<R>::data_size(); ++i) {
+      if (source.data_unsafe()[i] != -1) ++support;
+    }
+    if (support * Tensor<R>::data_size() > kMaxDirectWork) {
+      if (Shard::Processes() > 0) return ShardedFFTConvolution<R>::Square(target, source, target_anchor, source_anchor);
+      return FFTConvolution<R>::Square(target, source, target_anchor, source_anchor);
+    }
+  }
+  return BlockedConvolution<R>::Square(target, source, target_anchor, source_anchor);
 }
 
 template<class R, class C, class D>
-void DoubleCheckConvolution<R, C, D>::Square(Tensor<R>& target, const Tensor<R>& source, const Vector<R>& target_anchor, const Vector<R>& source_anchor) {
-  std::hash<std::string> h;
-  C::Square(target, source, target_anchor, source_anchor);
-  std::string s((char*)target.data_unsafe(), target.data_size() * sizeof(int));
-
-  D::Square(target, source, target_anchor, source_anchor);
-  std::string s_((char*)target.data_unsafe(), target.data_size() * sizeof(int));
-  std::cout << "Hashes: " << h(s) << ", " << h(s_) << std::endl;
-  if (h(s) != h(s_)) {
-    std::cerr << "Different hashes" << std::endl;
+std::size_t DoubleCheckConvolution<R, C, D>::Square(Tensor<R>& target, const Tensor<R>& source, const Vector<R>& target_anchor, const Vector<R>& source_anchor) {
+  std::size_t changed = C::Square(target, source, target_anchor, source_anchor);
+
+  Tensor<R> check;
+  std::size_t changed_ = D::Square(check, source, target_anchor, source_anchor);
+  std::size_t differences = Diff(target, check, std::cerr);
+  LOG << "Differences: " << differences << ", changed: " << changed << ", " << changed_ << std::endl;
+  if (differences > 0 || changed != changed_) {
+    std::cerr << differences << " different entries, changed " << changed << " and " << changed_ << std::endl;
     exit(1);
   }
+  return changed;
 }
 
 #define INSTANTIATE_CONVOLUTION(R) \
   template class NaiveConvolution<R>; \
   template class ParallelNaiveConvolution<R>; \
   template class DoubleCheckConvolution<R, FFTConvolution<R>, ParallelNaiveConvolution<R>>; \
-  template class FFTConvolution<R>;
+  template class DoubleCheckConvolution<R, BlockedConvolution<R>, ParallelNaiveConvolution<R>>; \
+  template class FFTConvolution<R>; \
+  template class ShardedFFTConvolution<R>; \
+  template class DoubleCheckConvolution<R, ShardedFFTConvolution<R>, ParallelNaiveConvolution<R>>; \
+  template class BlockedConvolution<R>; \
+  template class AutoConvolution<R>;
 ROUNDINGS_LIST(INSTANTIATE_CONVOLUTION)
+
+// NTTConvolution needs padded axes of length 9
+#define INSTANTIATE_NTT_CONVOLUTION(R) \
+  template class NTTConvolution<R>; \
+  template class DoubleCheckConvolution<R, NTTConvolution<R>, ParallelNaiveConvolution<R>>;
+UNPADDED_ROUNDINGS_LIST(INSTANTIATE_NTT_CONVOLUTION)
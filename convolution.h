@@ -4,30 +4,81 @@
 #include "tensor.h"
 #include "vector.h"
 
+/*
+ * Square(target, source, target_anchor, source_anchor) sets target to the
+ * min-plus square of source and returns the number of entries of target
+ * that differ from the entry of source with the same index. With equal
+ * anchors, zero means that source is a fixed point.
+ */
+
 template<class R>
 class NaiveConvolution {
  public:
-  static void Square(Tensor<R>& target, const Tensor<R>& source, const Vector<R>& target_anchor, const Vector<R>& target_source);
+  static std::size_t Square(Tensor<R>& target, const Tensor<R>& source, const Vector<R>& target_anchor, const Vector<R>& target_source);
 
 };
 
 template<class R>
 class ParallelNaiveConvolution {
  public:
-  static void Square(Tensor<R>& target, const Tensor<R>& source, const Vector<R>& target_anchor, const Vector<R>& target_source);
+  static std::size_t Square(Tensor<R>& target, const Tensor<R>& source, const Vector<R>& target_anchor, const Vector<R>& target_source);
 
 };
 
 template<class R>
 class FFTConvolution {
  public:
-  static void Square(Tensor<R>& target, const Tensor<R>& source, const Vector<R>& target_anchor, const Vector<R>& source_anchor);
+  static std::size_t Square(Tensor<R>& target, const Tensor<R>& source, const Vector<R>& target_anchor, const Vector<R>& source_anchor);
+};
+
+/*
+ * FFTConvolution with the pairs of value classes distributed over the
+ * worker processes of shard.h instead of threads. Source and target are
+ * shared through a segment, each worker lowers the target entries by
+ * compare-and-swap, so the pairs can be taken in any grouping. Falls back
+ * to FFTConvolution without workers.
+ */
+template<class R>
+class ShardedFFTConvolution {
+ public:
+  static std::size_t Square(Tensor<R>& target, const Tensor<R>& source, const Vector<R>& target_anchor, const Vector<R>& source_anchor);
+};
+
+/*
+ * Like FFTConvolution, with exact number-theoretic transforms over 32-bit
+ * residues instead of single precision FFTs.
+ */
+template<class R>
+class NTTConvolution {
+ public:
+  static std::size_t Square(Tensor<R>& target, const Tensor<R>& source, const Vector<R>& target_anchor, const Vector<R>& source_anchor);
+};
+
+/*
+ * Direct min-plus convolution over the finite source entries. The target is
+ * split into cache-sized blocks, one per task, and every source entry adds
+ * contiguous strips of the block that are valid by precomputed ranges.
+ */
+template<class R>
+class BlockedConvolution {
+ public:
+  static std::size_t Square(Tensor<R>& target, const Tensor<R>& source, const Vector<R>& target_anchor, const Vector<R>& source_anchor);
+};
+
+/*
+ * BlockedConvolution for small roundings or sparse sources, FFTConvolution
+ * otherwise (ShardedFFTConvolution if there are worker processes).
+ */
+template<class R>
+class AutoConvolution {
+ public:
+  static std::size_t Square(Tensor<R>& target, const Tensor<R>& source, const Vector<R>& target_anchor, const Vector<R>& source_anchor);
 };
 
 template<class R, class C, class D>
 class DoubleCheckConvolution {
  public:
-  static void Square(Tensor<R>& target, const Tensor<R>& source, const Vector<R>& target_anchor, const Vector<R>& source_anchor);
+  static std::size_t Square(Tensor<R>& target, const Tensor<R>& source, const Vector<R>& target_anchor, const Vector<R>& source_anchor);
 };
 
 
@@ -0,0 +1,127 @@
+#include "dynamic.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "heuristic.h"
+
+using namespace PCmax;
+
+// Moves per repair, each one lowers the load of a most loaded machine
+static constexpr int kMaxMoves = 8;
+
+DynamicSchedule::DynamicSchedule(nat m, const BDJR::RoundingInfo& rounding, double ratio) :
+  rounding_(rounding), ratio_(ratio > 0 ? ratio : rounding.ratio), solved_ratio_(1), resolves_(0),
+  changes_(0), load_(m, 0)
+{
+  I_.SetM(m);
+  S_.resize(m);
+  state_.small_loads.assign(m, 0);
+  for (nat u = 0; u < m; ++u) loads_.emplace(0, u);
+}
+
+bool DynamicSchedule::IsSmall(nat p) const {
+  return state_.T == 0 || p / (double)state_.T <= rounding_.eps;
+}
+
+void DynamicSchedule::Assign(nat u, nat p) {
+  loads_.erase(Load(load_[u], u));
+  load_[u] += p;
+  loads_.emplace(load_[u], u);
+  if (IsSmall(p)) state_.small_loads[u] += p;
+  S_[u].push_back(p);
+  machines_[p].push_back(u);
+}
+
+void DynamicSchedule::Unassign(nat u, nat p) {
+  loads_.erase(Load(load_[u], u));
+  load_[u] -= p;
+  loads_.emplace(load_[u], u);
+  if (IsSmall(p)) state_.small_loads[u] -= p;
+  S_[u].erase(std::find(S_[u].begin(), S_[u].end(), p));
+  auto& machines = machines_[p];
+  *std::find(machines.begin(), machines.end(), u) = machines.back();
+  machines.pop_back();
+}
+
+nat DynamicSchedule::Insert(nat p) {
+  ++I_.GetMap()[p];
+
+  nat u = loads_.begin()->second; // least loaded
+  nat T = state_.T;
+  if (!IsSmall(p) && p <= T) {
+    // most loaded machine that still fits p below T
+    auto fit = loads_.upper_bound(Load(T - p, std::numeric_limits<nat>::max()));
+    if (fit != loads_.begin()) u = std::prev(fit)->second;
+  }
+  Assign(u, p);
+
+  Rebalance();
+  CheckDrift();
+  return Makespan();
+}
+
+bool DynamicSchedule::Remove(nat p) {
+  auto& jobs = I_.GetMap();
+  auto j = jobs.find(p);
+  auto i = machines_.find(p);
+  if (j == jobs.end() || i == machines_.end() || i->second.empty()) return false;
+  if (--j->second == 0) jobs.erase(j);
+
+  // from the most loaded machine that runs such a job
+  const auto& machines = i->second;
+  nat u = *std::max_element(machines.begin(), machines.end(),
+    [this](nat a, nat b) { return load_[a] < load_[b]; });
+  Unassign(u, p);
+
+  Rebalance();
+  CheckDrift();
+  return true;
+}
+
+void DynamicSchedule::Rebalance() {
+  for (int k = 0; k < kMaxMoves; ++k) {
+    nat v = loads_.rbegin()->second, w = loads_.begin()->second;
+    nat gap = load_[v] - load_[w];
+    if (state_.small_loads[v] == 0) break;
+    nat best = 0;
+    for (nat p : S_[v]) if (p < gap && p > best && IsSmall(p)) best = p;
+    if (best == 0) break;
+    Unassign(v, best);
+    Assign(w, best);
+  }
+}
+
+void DynamicSchedule::CheckDrift() {
+  if (++changes_ < kMinChanges || I_.GetMap().empty()) return;
+  nat lb = LowerBound(I_);
+  if (Makespan() > std::max(ratio_, solved_ratio_ + kDriftMargin) * lb) Resolve();
+}
+
+void DynamicSchedule::Resolve() {
+  nat m = I_.GetM();
+  Schedule S;
+  BDJR::State state;
+  if (!I_.GetMap().empty() && (rounding_.ComputeState(I_, S, state) == 0 || !S.IsFeasibleForInstance(I_))) {
+    // interrupted or failed, S may lack jobs
+    S.clear();
+    state = BDJR::State();
+    LPT::ComputeSchedule(I_, S);
+  }
+
+  // the small loads of the solve are those of the jobs with p/T <= eps
+  state_ = std::move(state);
+  state_.small_loads.assign(m, 0);
+  S_.assign(m, std::vector<nat>());
+  load_.assign(m, 0);
+  loads_.clear();
+  for (nat u = 0; u < m; ++u) loads_.emplace(0, u);
+  machines_.clear();
+  for (nat u = 0; u < S.size(); ++u) {
+    for (nat p : S[u]) Assign(u, p);
+  }
+
+  solved_ratio_ = I_.GetMap().empty() ? 1 : Makespan() / (double)LowerBound(I_);
+  changes_ = 0;
+  ++resolves_;
+}
@@ -0,0 +1,111 @@
+#ifndef DYNAMIC_H_
+#define DYNAMIC_H_
+
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "pcmax.h"
+#include "bdjr.h"
+
+namespace PCmax {
+
+/*
+ * A schedule of a job set that changes a few jobs at a time. Insertions and
+ * deletions are repaired locally with the state of the last full BDJR solve
+ * (BDJR::State). Jobs are small as in BDJR if p/T <= eps for its makespan T.
+ * A small job goes to the least loaded machine as in the LPT phase of BDJR,
+ * a larger one to the most loaded machine where it fits below T. Afterwards
+ * single small jobs are moved from the most to the least loaded machine as
+ * long as this lowers the makespan, so the huge pairs and configurations of
+ * the solve are only changed by the inserted and removed jobs.
+ *
+ * BDJR solves from scratch once the makespan exceeds max(ratio, r + margin)
+ * times LowerBound(I), where r is the ratio of the last full solve itself
+ * (which local repair cannot be expected to beat). The margin and a minimum
+ * number of changes between solves keep it from solving after every change.
+ */
+class DynamicSchedule {
+ public:
+  static constexpr double kDriftMargin = 0.01;
+  static constexpr nat kMinChanges = 16;
+
+  /* ratio 0 uses the guarantee of the rounding. */
+  DynamicSchedule(nat m, const BDJR::RoundingInfo& rounding, double ratio = 0);
+
+  /* Adds a job of size p > 0 and returns the makespan. */
+  nat Insert(nat p);
+
+  /* Removes a job of size p, false if there is none. */
+  bool Remove(nat p);
+
+  /*
+   * Discards the schedule and solves the current jobs by BDJR, or by LPT
+   * if BDJR is interrupted (Interrupt::Deadline of the caller) or fails.
+   * After LPT, the state is empty (T = 0) and all jobs count as small.
+   */
+  void Resolve();
+
+  nat Makespan() const {
+    return loads_.empty() ? 0 : loads_.rbegin()->first;
+  }
+
+  const Schedule& GetSchedule() const {
+    return S_;
+  }
+
+  const Instance& GetInstance() const {
+    return I_;
+  }
+
+  /*
+   * State of the last full solve. Only small_loads follows the changes,
+   * b and the configurations do not contain the jobs changed since.
+   */
+  const BDJR::State& GetState() const {
+    return state_;
+  }
+
+  /* Makespan / LowerBound of the last full solve. */
+  double SolvedRatio() const {
+    return solved_ratio_;
+  }
+
+  /* Number of full solves so far. */
+  nat Resolves() const {
+    return resolves_;
+  }
+
+  /* Changes since the last full solve. */
+  nat Changes() const {
+    return changes_;
+  }
+
+ private:
+  typedef std::pair<nat, nat> Load; // (load, machine)
+
+  bool IsSmall(nat p) const;
+  void Assign(nat u, nat p);
+  void Unassign(nat u, nat p);
+  void Rebalance();
+  void CheckDrift();
+
+  const BDJR::RoundingInfo& rounding_;
+  double ratio_;
+  double solved_ratio_;
+  BDJR::State state_;
+  nat resolves_;
+  nat changes_;
+
+  Instance I_;
+  Schedule S_;
+  std::vector<nat> load_;
+  std::set<Load> loads_;
+  std::unordered_map<nat, std::vector<nat>> machines_; // machines of the jobs of each size
+};
+
+}
+
+#endif // DYNAMIC_H_
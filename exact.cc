@@ -0,0 +1,95 @@
+#include "exact.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "heuristic.h"
+#include "bounds.h"
+
+using namespace PCmax;
+
+namespace {
+
+struct Search {
+  std::vector<nat> p;      // jobs, decreasing
+  std::vector<nat> rest;   // rest[k] = p[k] + ... + p[n-1]
+  std::vector<nat> load;
+  std::vector<nat> assignment, best_assignment;
+  nat best;                // makespan to beat
+  nat lower;
+  std::size_t nodes, max_nodes;
+
+  /* true once best == lower, i.e. nothing left to find */
+  bool Branch(std::size_t k, nat makespan) {
+    if (k == p.size()) {
+      best = makespan;
+      best_assignment = assignment;
+      return best <= lower;
+    }
+    if (nodes >= max_nodes) return false;
+    ++nodes;
+
+    // the remaining jobs have to fit below best on all machines
+    nat room = 0;
+    for (nat l : load) room += best - 1 - std::min(l, best - 1);
+    if (rest[k] > room) return false;
+
+    const nat m = load.size();
+    for (nat u = 0; u < m; ++u) {
+      if (load[u] + p[k] >= best) continue;
+      bool seen = false;
+      for (nat v = 0; v < u && !seen; ++v) seen = load[v] == load[u];
+      if (seen) continue; // same subtree as machine v
+
+      load[u] += p[k];
+      assignment[k] = u;
+      bool done = Branch(k + 1, std::max(makespan, load[u]));
+      load[u] -= p[k];
+      if (done) return true;
+    }
+    return false;
+  }
+};
+
+}
+
+nat Exact::ComputeSchedule(const Instance& I, Schedule& S, std::size_t max_nodes, bool& proven) {
+  Schedule S_lpt, S_mf;
+  nat u_lpt = LPT::ComputeSchedule(I, S_lpt);
+  nat u_mf = MF::ComputeSchedule(I, S_mf);
+  return ComputeSchedule(I, S, max_nodes, proven, u_mf < u_lpt ? S_mf : S_lpt, std::min(u_lpt, u_mf));
+}
+
+nat Exact::ComputeSchedule(const Instance& I, Schedule& S, std::size_t max_nodes, bool& proven,
+  const Schedule& incumbent, nat u) {
+  Search search;
+  search.lower = Bounds::LowerBound(I, u);
+  search.best = u;
+  search.nodes = 0;
+  search.max_nodes = max_nodes;
+  for (auto j = I.GetMap().rbegin(); j != I.GetMap().rend(); ++j) {
+    search.p.insert(search.p.end(), j->second, j->first);
+  }
+  const std::size_t n = search.p.size();
+  search.rest.assign(n + 1, 0);
+  for (std::size_t k = n; k-- > 0; ) search.rest[k] = search.rest[k+1] + search.p[k];
+  search.load.assign(I.GetM(), 0);
+  search.assignment.assign(n, 0);
+
+  if (search.lower < u) search.Branch(0, 0);
+  proven = search.best <= search.lower || search.nodes < max_nodes;
+
+  if (search.best_assignment.empty()) { // the heuristics were optimal or the search gave up
+    S.insert(S.end(), incumbent.begin(), incumbent.end());
+    return u;
+  }
+  std::size_t offset = S.size();
+  S.resize(offset + I.GetM());
+  for (std::size_t k = 0; k < n; ++k) S[offset + search.best_assignment[k]].push_back(search.p[k]);
+  return search.best;
+}
+
+nat Exact::ComputeSchedule(const Instance& I, Schedule& S) {
+  bool proven;
+  return ComputeSchedule(I, S, kMaxNodes, proven);
+}
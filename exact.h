@@ -0,0 +1,39 @@
+#ifndef EXACT_H_
+#define EXACT_H_
+
+#include <cstddef>
+
+#include "pcmax.h"
+
+namespace PCmax {
+
+  namespace Exact {
+    /*
+     * Branch and bound over the jobs in decreasing order, starting from the
+     * better of LPT and MF and the bounds of Bounds::LowerBound. A job only
+     * goes to the first of the machines with equal loads, and a branch is
+     * cut once the remaining jobs cannot fit below the best makespan.
+     *
+     * Returns the makespan of S, which is optimal if proven is set; after
+     * max_nodes branches it is the best schedule found so far.
+     */
+    nat ComputeSchedule(const Instance& I, Schedule& S, std::size_t max_nodes, bool& proven);
+
+    /*
+     * Same as above, starting from the schedule incumbent of I with makespan
+     * u (e.g. the better of LPT and MF of the caller) instead of computing
+     * LPT and MF again.
+     */
+    nat ComputeSchedule(const Instance& I, Schedule& S, std::size_t max_nodes, bool& proven,
+      const Schedule& incumbent, nat u);
+
+    /* Node limit of the variant below. */
+    constexpr std::size_t kMaxNodes = std::size_t(1) << 24;
+
+    /* The first variant with kMaxNodes, whether proven or not. */
+    nat ComputeSchedule(const Instance& I, Schedule& S);
+  }
+
+}
+
+#endif // EXACT_H_
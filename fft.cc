@@ -0,0 +1,54 @@
+#include <mutex>
+
+#include "fft.h"
+
+// The FFTW planner is not thread safe, only the execution of plans is.
+static std::mutex planner_mutex;
+static unsigned planner_flags = FFTW_ESTIMATE;
+
+bool FFT::ParsePlanner(const std::string& name, Planner& planner) {
+  if (name == "estimate") planner = Planner::Estimate;
+  else if (name == "measure") planner = Planner::Measure;
+  else if (name == "patient") planner = Planner::Patient;
+  else return false;
+  return true;
+}
+
+void FFT::SetPlanner(Planner planner) {
+  std::lock_guard<std::mutex> lock(planner_mutex);
+  switch (planner) {
+    case Planner::Estimate: planner_flags = FFTW_ESTIMATE; break;
+    case Planner::Measure:  planner_flags = FFTW_MEASURE;  break;
+    case Planner::Patient:  planner_flags = FFTW_PATIENT;  break;
+  }
+}
+
+bool FFT::ImportWisdom(const char* file) {
+  std::lock_guard<std::mutex> lock(planner_mutex);
+  return fftwf_import_wisdom_from_filename(file) != 0;
+}
+
+bool FFT::ExportWisdom(const char* file) {
+  std::lock_guard<std::mutex> lock(planner_mutex);
+  return fftwf_export_wisdom_to_filename(file) != 0;
+}
+
+FFT::Plans FFT::Create(int rank, const int* n) {
+  std::lock_guard<std::mutex> lock(planner_mutex);
+
+  // Measuring overwrites the arrays, so it needs scratch space of the
+  // actual size. Estimating does not touch them.
+  fftwf_complex* buf = nullptr;
+  if (planner_flags != FFTW_ESTIMATE) {
+    std::size_t size = 1;
+    for (int i = 0; i < rank; ++i) size *= n[i];
+    buf = (fftwf_complex*)fftwf_malloc(size * sizeof(fftwf_complex));
+  }
+
+  Plans plans;
+  plans.forward = fftwf_plan_dft(rank, n, buf, buf, FFTW_FORWARD, planner_flags);
+  plans.backward = fftwf_plan_dft(rank, n, buf, buf, FFTW_BACKWARD, planner_flags);
+
+  if (buf) fftwf_free(buf);
+  return plans;
+}
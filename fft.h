@@ -0,0 +1,47 @@
+#ifndef FFT_H_
+#define FFT_H_
+
+#include <string>
+#include <fftw3.h>
+
+/*
+ * FFTW plans are created once per transform shape and shared by all threads:
+ * they are executed in place on the threads' own buffers through
+ * fftwf_execute_dft, which requires buffers aligned like those of
+ * fftwf_malloc (Memory::Allocate aligns to cache lines at least).
+ */
+namespace FFT {
+
+  enum class Planner { Estimate, Measure, Patient };
+
+  bool ParsePlanner(const std::string& name, Planner& planner);
+
+  /* Only affects plans which are not created yet. */
+  void SetPlanner(Planner planner);
+
+  /* Wisdom makes Measure and Patient plans as cheap as Estimate ones. */
+  bool ImportWisdom(const char* file);
+  bool ExportWisdom(const char* file);
+
+  struct Plans {
+    fftwf_plan forward;
+    fftwf_plan backward;
+  };
+
+  /* In-place plans of shape n[0] x ... x n[rank-1]. */
+  Plans Create(int rank, const int* n);
+
+  /* The plans of the tensors of rounding R, created on first use. */
+  template<class R>
+  const Plans& PlansOf() {
+    static const Plans plans = [] {
+      int n[R::Dim()];
+      for (int i = 0; i < R::Dim(); ++i) n[i] = R::Deviation(i);
+      return Create(R::Dim(), n);
+    }();
+    return plans;
+  }
+
+}
+
+#endif // FFT_H_
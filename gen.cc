@@ -0,0 +1,68 @@
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+
+#include "generator.h"
+
+/*
+ * Writes random instances of the PSMF families (see generator.h). One
+ * instance goes to stdout; with --dir, --count instances with consecutive
+ * seeds are written to DIR/M<m>_N<n>_<family>_<k>.dat as in instances/PSMF.
+ */
+
+using namespace PCmax;
+using namespace std;
+
+static void Usage(const char* program) {
+  cerr << "Usage: " << program << " --family=F --machines=M --jobs=N [options]" << endl
+       << "  --family=F   U<a>_<b> (uniform in [a,b]) or NU<R> (98% in [0.9R,R], 2% in [1,0.2R])" << endl
+       << "  --machines=M number of machines" << endl
+       << "  --jobs=N     number of jobs" << endl
+       << "  --seed=S     seed of the first instance (default: 1)" << endl
+       << "  --count=K    number of instances (default: 1), requires --dir if K > 1" << endl
+       << "  --dir=DIR    output directory instead of stdout" << endl;
+}
+
+int main(int argc, const char* argv[]) {
+  Generator::Parameters P;
+  bool family = false;
+  unsigned count = 1;
+  const char* dir = nullptr;
+
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    if (!strncmp(arg, "--family=", 9)) family = Generator::ParseFamily(arg + 9, P);
+    else if (!strncmp(arg, "--machines=", 11)) P.m = strtoull(arg + 11, nullptr, 10);
+    else if (!strncmp(arg, "--jobs=", 7)) P.n = strtoull(arg + 7, nullptr, 10);
+    else if (!strncmp(arg, "--seed=", 7)) P.seed = strtoull(arg + 7, nullptr, 10);
+    else if (!strncmp(arg, "--count=", 8)) count = atoi(arg + 8);
+    else if (!strncmp(arg, "--dir=", 6)) dir = arg + 6;
+    else {
+      Usage(argv[0]);
+      return 1;
+    }
+  }
+  if (!family || !Generator::IsValid(P) || count == 0 || (count > 1 && !dir)) {
+    Usage(argv[0]);
+    return 1;
+  }
+
+  if (!dir) return Generator::Write(P, stdout) ? 0 : 1;
+
+  filesystem::create_directories(dir);
+  for (unsigned k = 1; k <= count; ++k, ++P.seed) {
+    char number[16];
+    snprintf(number, sizeof(number), "_%03u.dat", k);
+    string file = (filesystem::path(dir) / (Generator::Name(P) + number)).string();
+    FILE* out = fopen(file.c_str(), "w");
+    bool written = out && Generator::Write(P, out);
+    if (out) fclose(out);
+    if (!written) {
+      cerr << "Cannot write " << file << endl;
+      return 1;
+    }
+  }
+  return 0;
+}
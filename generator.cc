@@ -0,0 +1,98 @@
+#include "generator.h"
+
+#include <cstdlib>
+
+using namespace PCmax;
+using namespace PCmax::Generator;
+
+namespace {
+
+  class Source {
+   public:
+    explicit Source(const Parameters& P) : P_(P), state_(P.seed) {}
+
+    nat Next() {
+      if (P_.family == Family::NonUniform && Below(100) < 2) {
+        return Uniform(1, P_.b / 5);
+      }
+      if (P_.family == Family::NonUniform) return Uniform(P_.b - P_.b / 10, P_.b);
+      return Uniform(P_.a, P_.b);
+    }
+
+   private:
+    // splitmix64
+    std::uint64_t Random() {
+      std::uint64_t z = (state_ += 0x9E3779B97F4A7C15ull);
+      z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+      z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+      return z ^ (z >> 31);
+    }
+
+    // modulo bias below 2^-32 for ranges up to 2^32
+    std::uint64_t Below(std::uint64_t k) {
+      return Random() % k;
+    }
+
+    nat Uniform(nat a, nat b) {
+      return a + Below(b - a + 1);
+    }
+
+    const Parameters& P_;
+    std::uint64_t state_;
+  };
+
+  bool ParseNat(const std::string& s, nat& x) {
+    if (s.empty() || s.find_first_not_of("0123456789") != std::string::npos) return false;
+    x = std::strtoull(s.c_str(), nullptr, 10);
+    return true;
+  }
+
+}
+
+bool Generator::ParseFamily(const std::string& family, Parameters& P) {
+  if (family.compare(0, 2, "NU") == 0) {
+    P.family = Family::NonUniform;
+    P.a = 1;
+    return ParseNat(family.substr(2), P.b);
+  }
+  std::size_t sep = family.find('_');
+  if (family.empty() || family[0] != 'U' || sep == std::string::npos) return false;
+  P.family = Family::Uniform;
+  return ParseNat(family.substr(1, sep - 1), P.a) && ParseNat(family.substr(sep + 1), P.b);
+}
+
+std::string Generator::FamilyName(const Parameters& P) {
+  if (P.family == Family::NonUniform) return "NU" + std::to_string(P.b);
+  return "U" + std::to_string(P.a) + "_" + std::to_string(P.b);
+}
+
+std::string Generator::Name(const Parameters& P) {
+  return "M" + std::to_string(P.m) + "_N" + std::to_string(P.n) + "_" + FamilyName(P);
+}
+
+bool Generator::IsValid(const Parameters& P) {
+  if (P.m == 0 || P.n == 0) return false;
+  if (P.family == Family::NonUniform) return P.b >= 5;
+  return 1 <= P.a && P.a <= P.b;
+}
+
+void Generator::Generate(const Parameters& P, std::vector<nat>& p) {
+  Source source(P);
+  p.resize(P.n);
+  for (nat& x : p) x = source.Next();
+}
+
+void Generator::Generate(const Parameters& P, Instance& I) {
+  Source source(P);
+  I.Clear();
+  I.SetM(P.m);
+  auto& map = I.GetMap();
+  for (nat j = 0; j < P.n; ++j) ++map[source.Next()];
+}
+
+bool Generator::Write(const Parameters& P, std::FILE* out) {
+  Source source(P);
+  std::fprintf(out, "%llu\n%llu\n", (unsigned long long)P.m, (unsigned long long)P.n);
+  for (nat j = 0; j < P.n; ++j) std::fprintf(out, "%llu\n", (unsigned long long)source.Next());
+  return std::fflush(out) == 0 && !std::ferror(out);
+}
@@ -0,0 +1,63 @@
+#ifndef GENERATOR_H_
+#define GENERATOR_H_
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "pcmax.h"
+
+namespace PCmax {
+
+  namespace Generator {
+    /*
+     * Job size distributions of instances/PSMF:
+     *   Uniform     integer p uniform in [a, b] (E1-E4, BIG: U1_20, U20_50,
+     *               U50_100, U1_100, U100_200, U100_800, U1_1000)
+     *   NonUniform  98% of the jobs uniform in [0.9R, R] and 2% in [1, 0.2R]
+     *               (NON_UNIFORMI, R = b = 100, 1000, 10000)
+     */
+    enum class Family { Uniform, NonUniform };
+
+    struct Parameters {
+      Family family = Family::Uniform;
+      nat m = 0;
+      nat n = 0;
+      nat a = 1;
+      nat b = 100;
+      std::uint64_t seed = 1;
+    };
+
+    /* Reads the family "U<a>_<b>" or "NU<R>" into P. */
+    bool ParseFamily(const std::string& family, Parameters& P);
+
+    /* "U<a>_<b>" or "NU<R>". */
+    std::string FamilyName(const Parameters& P);
+
+    /* PSMF file name without instance number, e.g. M6_N100_U100_800. */
+    std::string Name(const Parameters& P);
+
+    /* False unless m, n > 0 and 1 <= a <= b (NonUniform: b >= 5). */
+    bool IsValid(const Parameters& P);
+
+    /*
+     * The job sizes of the instance of P in the order of generation. The
+     * generator (splitmix64) does not depend on the standard library, so a
+     * seed gives the same instance on every platform.
+     */
+    void Generate(const Parameters& P, std::vector<nat>& p);
+
+    /* Same as above as an instance. */
+    void Generate(const Parameters& P, Instance& I);
+
+    /*
+     * Writes the instance of P in the format m \n n \n p1 \n p2 ... as it
+     * is generated, false on a write error.
+     */
+    bool Write(const Parameters& P, std::FILE* out);
+  }
+
+}
+
+#endif // GENERATOR_H_
@@ -5,6 +5,8 @@
 #include <numeric>
 
 #include "heuristic.h"
+#include "bounds.h"
+#include "log.h"
 
 using namespace PCmax;
 
@@ -103,9 +105,9 @@ static bool FFD(const Instance& I, nat T) {
 }
 
 nat MF::ComputeMakespan(const Instance& I) {
-  nat l = LowerBound(I);
   nat u = LPT::ComputeMakespan(I);
-  std::cout << "Bounds: l = " << l << ", u = " << u << std::endl;
+  nat l = Bounds::LowerBound(I, u);
+  LOG << "Bounds: l = " << l << ", u = " << u << std::endl;
 
   while (l != u) {
 	  nat T = (l + u) / 2;
@@ -0,0 +1,75 @@
+#ifndef INTERRUPT_H_
+#define INTERRUPT_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+/*
+ * Cooperative cancellation. The convolutions, the fixed-point iteration and
+ * the backtrace poll the flag of the thread that started them and return
+ * early (with incomplete results) once it is set.
+ */
+class Interrupt {
+ public:
+  /*
+   * The flag of the calling thread. Parallel regions read it once before
+   * they start, since it is thread local.
+   */
+  static const std::atomic_bool& Flag() {
+    return *current_;
+  }
+
+  static bool Requested() {
+    return current_->load(std::memory_order_relaxed);
+  }
+
+  /*
+   * Installs a fresh flag for the calling thread that is set when the
+   * deadline passes. The previous flag is restored on destruction.
+   */
+  class Deadline {
+   public:
+    explicit Deadline(std::chrono::steady_clock::time_point deadline) :
+      previous_(current_), done_(false)
+    {
+      flag_ = false;
+      current_ = &flag_;
+      watchdog_ = std::thread([this, deadline] {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!cv_.wait_until(lock, deadline, [this] { return done_; })) {
+          flag_ = true;
+        }
+      });
+    }
+
+    ~Deadline() {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        done_ = true;
+      }
+      cv_.notify_one();
+      watchdog_.join();
+      current_ = previous_;
+    }
+
+    Deadline(const Deadline&) = delete;
+    Deadline& operator=(const Deadline&) = delete;
+
+   private:
+    std::atomic_bool flag_;
+    std::atomic_bool* previous_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool done_;
+    std::thread watchdog_;
+  };
+
+ private:
+  static inline std::atomic_bool never_{false};
+  static inline thread_local std::atomic_bool* current_ = &never_;
+};
+
+#endif // INTERRUPT_H_
@@ -0,0 +1,190 @@
+#include "libbdjr.h"
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include <omp.h>
+
+#include "pcmax.h"
+#include "bdjr.h"
+#include "scheduler.h"
+#include "log.h"
+
+using namespace PCmax;
+
+struct bdjr_solver {
+  const BDJR::RoundingInfo* rounding;
+  int threads;
+  std::chrono::milliseconds budget{0};
+  std::string error;
+
+  // kept across calls
+  Instance I;
+  Schedule S;
+  std::vector<std::pair<nat, std::uint32_t>> jobs; // (p, job) sorted
+  std::vector<nat> sizes;                          // distinct p
+  std::vector<std::size_t> next;                   // next job of each size in jobs
+};
+
+/*
+ * Peak memory of a solve: two tensors (see TensorPool) with the index
+ * tables of the FFT, and two padded complex buffers per FFT thread if the
+ * rounding may use FFTConvolution (AutoConvolution, Dim() > 5).
+ */
+static std::size_t Entries(int base, int dim) {
+  std::size_t n = 1;
+  for (int i = 0; i < dim; ++i) n *= base;
+  return n;
+}
+
+static std::size_t SharedMemory(int dim) {
+  return Entries(6, dim) * (2 * sizeof(int) + 2 * sizeof(unsigned));
+}
+
+static std::size_t MemoryPerThread(int dim) {
+  return dim > 5 ? Entries(9, dim) * 2 * 2 * sizeof(float) : 0;
+}
+
+static bdjr_solver* Create(const char* rounding, int threads, size_t memory_limit) {
+  const BDJR::RoundingInfo* info = &BDJR::Roundings().front();
+  if (rounding) {
+    info = nullptr;
+    for (auto const& r : BDJR::Roundings()) if (r.name == std::string(rounding)) info = &r;
+    if (!info) return nullptr;
+  }
+
+  if (threads <= 0) threads = omp_get_max_threads();
+  if (memory_limit > 0) {
+    std::size_t shared = SharedMemory(info->dim), per_thread = MemoryPerThread(info->dim);
+    if (shared + per_thread > memory_limit) return nullptr;
+    if (per_thread > 0) {
+      threads = std::min<std::size_t>(threads, (memory_limit - shared) / per_thread);
+    }
+  }
+
+  // process settings, once so that concurrent creates do not race
+  static std::once_flag settings;
+  std::call_once(settings, [] {
+    verbose = false; // no diagnostics on the stdout of the application
+    cached_min_machines = std::max<std::size_t>(cached_min_machines, 1 << 16);
+  });
+
+  bdjr_solver* solver = new bdjr_solver();
+  solver->rounding = info;
+  solver->threads = threads;
+  return solver;
+}
+
+namespace {
+
+  /* Sets the OpenMP threads of a solve and restores those of the application. */
+  struct ThreadsGuard {
+    explicit ThreadsGuard(int threads) : previous(omp_get_max_threads()) {
+      omp_set_num_threads(threads);
+    }
+    ~ThreadsGuard() {
+      omp_set_num_threads(previous);
+    }
+    int previous;
+  };
+
+}
+
+static int Solve(bdjr_solver* solver, uint64_t m, size_t n, const uint64_t* p,
+  uint32_t* machine, uint64_t* makespan) {
+  // Instance from the sorted jobs, which also assign the loads to jobs below
+  auto& jobs = solver->jobs;
+  jobs.resize(n);
+  for (std::size_t j = 0; j < n; ++j) jobs[j] = {p[j], (std::uint32_t)j};
+  std::sort(jobs.begin(), jobs.end());
+
+  Instance& I = solver->I;
+  I.Clear();
+  I.SetM(m);
+  auto& map = I.GetMap();
+  solver->sizes.clear();
+  solver->next.clear();
+  for (std::size_t j = 0; j < n; ++j) {
+    if (j == 0 || jobs[j].first != jobs[j-1].first) {
+      solver->sizes.push_back(jobs[j].first);
+      solver->next.push_back(j);
+    }
+    ++map.emplace_hint(map.end(), jobs[j].first, 0)->second;
+  }
+
+  Schedule& S = solver->S;
+  S.clear();
+  nat T;
+  {
+    ThreadsGuard threads(solver->threads);
+    if (solver->budget.count() > 0) {
+      BDJR::Stage stage;
+      T = BDJR::ComputeSchedule(I, S, solver->budget, stage, *solver->rounding);
+    } else {
+      T = solver->rounding->ComputeSchedule(I, S);
+    }
+  }
+
+  if (T == 0 || !S.IsFeasibleForInstance(I)) {
+    solver->error = "no feasible schedule";
+    return BDJR_FAILED;
+  }
+
+  for (std::size_t u = 0; u < S.size(); ++u) {
+    for (nat load : S[u]) {
+      auto k = std::lower_bound(solver->sizes.begin(), solver->sizes.end(), load) - solver->sizes.begin();
+      machine[jobs[solver->next[k]++].second] = (std::uint32_t)u;
+    }
+  }
+  *makespan = S.ComputeMakespan();
+  return BDJR_OK;
+}
+
+/*
+ * No exception may leave the C interface, e.g. std::bad_alloc of the
+ * tensors ends the solve with BDJR_FAILED.
+ */
+bdjr_solver* bdjr_create(const char* rounding, int threads, size_t memory_limit) {
+  try {
+    return Create(rounding, threads, memory_limit);
+  } catch (const std::exception&) {
+    return nullptr;
+  }
+}
+
+void bdjr_destroy(bdjr_solver* solver) {
+  delete solver;
+}
+
+void bdjr_set_deadline(bdjr_solver* solver, int64_t deadline_ms) {
+  solver->budget = std::chrono::milliseconds(std::max<int64_t>(0, deadline_ms));
+}
+
+const char* bdjr_error(const bdjr_solver* solver) {
+  return solver->error.c_str();
+}
+
+int bdjr_solve(bdjr_solver* solver, uint64_t m, size_t n, const uint64_t* p,
+  uint32_t* machine, uint64_t* makespan) {
+
+  solver->error.clear();
+  if (m == 0 || n == 0 || !p || !machine || !makespan) {
+    solver->error = "no machines, no jobs or null pointers";
+    return BDJR_INVALID;
+  }
+  if (std::find(p, p + n, 0) != p + n) {
+    solver->error = "job of size 0";
+    return BDJR_INVALID;
+  }
+
+  try {
+    return Solve(solver, m, n, p, machine, makespan);
+  } catch (const std::exception& e) {
+    solver->error = e.what();
+    return BDJR_FAILED;
+  }
+}
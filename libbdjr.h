@@ -0,0 +1,62 @@
+#ifndef LIBBDJR_H_
+#define LIBBDJR_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * C interface of the BDJR solver (libbdjr.a, libbdjr.so).
+ *
+ * A solver handle keeps its scratch memory across calls, and the process
+ * keeps the FFTW plans, idle tensors and MinMachines results of all
+ * handles. A handle must not be used by several threads at once; different
+ * handles may be created and solve concurrently. The first bdjr_create
+ * turns off the diagnostics of the solver for the whole process.
+ */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct bdjr_solver bdjr_solver;
+
+enum bdjr_status {
+  BDJR_OK = 0,
+  BDJR_INVALID = 1,  /* no machines, no jobs, a job of size 0 or null pointers */
+  BDJR_FAILED = 2    /* internal error (e.g. out of memory), no feasible schedule */
+};
+
+/*
+ * rounding:     name of the rounding as in sched --rounding, NULL for the
+ *               default (rounding9)
+ * threads:      OpenMP threads per solve, 0 for all
+ * memory_limit: bytes the tensors and FFT buffers of a solve may use, 0 for
+ *               no limit. The FFT threads are reduced to stay below it.
+ * Returns NULL if the rounding is unknown, does not fit into the limit or
+ * there is not enough memory.
+ */
+bdjr_solver* bdjr_create(const char* rounding, int threads, size_t memory_limit);
+
+void bdjr_destroy(bdjr_solver* solver);
+
+/*
+ * Bounds the time of every solve: the best schedule of LPT, MF and BDJR
+ * completed within deadline_ms is returned. 0 (default) waits for BDJR.
+ */
+void bdjr_set_deadline(bdjr_solver* solver, int64_t deadline_ms);
+
+/*
+ * Schedules the n jobs with processing times p[0..n-1] on m machines.
+ * machine[j] (caller provided, n entries) receives the machine of job j in
+ * 0..m-1 and *makespan the makespan of the schedule.
+ */
+int bdjr_solve(bdjr_solver* solver, uint64_t m, size_t n, const uint64_t* p,
+  uint32_t* machine, uint64_t* makespan);
+
+/* Description of the last error of the handle. */
+const char* bdjr_error(const bdjr_solver* solver);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LIBBDJR_H_
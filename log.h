@@ -0,0 +1,15 @@
+#ifndef LOG_H_
+#define LOG_H_
+
+#include <iostream>
+
+/*
+ * Diagnostic output of the algorithms (bounds, anchors, intermediate
+ * schedules). It is enabled by default and switched off by the driver for
+ * the compact, binary and summary output formats.
+ */
+inline bool verbose = true;
+
+#define LOG if (!verbose) {} else std::cout
+
+#endif // LOG_H_
@@ -1,15 +1,27 @@
 #include <iostream>
 #include <filesystem>
 #include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include <functional>
+#include <memory>
 
-#include "rounding.h"
-#include "scheduler.h"
-#include "convolution.h"
 #include "pcmax.h"
 #include "bdjr.h"
 #include "heuristic.h"
-
-typedef Rounding9<0> R;
+#include "exact.h"
+#include "portfolio.h"
+#include "output.h"
+#include "server.h"
+#include "pipeline.h"
+#include "fft.h"
+#include "shard.h"
+#include "memory.h"
+#include "log.h"
 
 using namespace PCmax;
 using namespace std;
@@ -22,10 +34,39 @@ inline void ScaleInstance(Instance& I, nat scaleM, nat scaleN) {
   }
 }
 
+/*
+ * Output of one instance. The records are written by the writer stage in
+ * order, or right away if the diagnostics of the algorithms go to stdout
+ * between them.
+ */
+class Records {
+ public:
+  typedef function<void(ScheduleWriter&)> Record;
+
+  explicit Records(ScheduleWriter* direct = nullptr) : direct_(direct) {}
+
+  void Add(Record record) {
+    if (direct_) record(*direct_);
+    else records_.push_back(std::move(record));
+  }
+
+  void Note(const string& note) {
+    Add([note](ScheduleWriter& out) { out.WriteNote(note.c_str()); });
+  }
+
+  void WriteTo(ScheduleWriter& out) const {
+    for (auto const& record : records_) record(out);
+  }
+
+ private:
+  ScheduleWriter* direct_;
+  vector<Record> records_;
+};
+
 inline nat RunExperiment(const char* name, nat (*ComputeSchedule)(const Instance&, Schedule&),
-  const Instance& I, Schedule& S) {
+  const Instance& I, Records& out) {
 
-  S.clear();
+  Schedule S;
 
   auto start = chrono::steady_clock::now();
 
@@ -34,40 +75,245 @@ inline nat RunExperiment(const char* name, nat (*ComputeSchedule)(const Instance
   auto stop = chrono::steady_clock::now();
   auto ms = chrono::duration_cast<chrono::milliseconds>(stop-start);
 
-  const char* ok = S.IsFeasibleForInstance(I) ? "ok" : "FAIL";
-
-  cout << name << ": " << makespan << " " << ms.count() << " " << ok << S << endl;
+  bool ok = S.IsFeasibleForInstance(I);
+  out.Add([name, makespan, ms, ok, S = std::move(S)](ScheduleWriter& out) {
+    out.WriteResult(name, makespan, ms.count(), ok, S);
+  });
 
   return makespan;
 }
 
+// Instances read ahead and results waiting to be written
+static constexpr size_t kPipelineDepth = 4;
+
+static chrono::milliseconds budget(0);
+static BDJR::Stage stage;
+
+inline nat AnytimeBDJR(const Instance& I, Schedule& S) {
+  return BDJR::ComputeSchedule(I, S, budget, stage);
+}
+
+static bool proven;
+
+inline nat ExactSchedule(const Instance& I, Schedule& S) {
+  return Exact::ComputeSchedule(I, S, Exact::kMaxNodes, proven);
+}
+
+static double target = 0;
+static Portfolio::Choice choice;
+static Portfolio::Features features;
+
+inline nat PortfolioSchedule(const Instance& I, Schedule& S) {
+  return Portfolio::ComputeSchedule(I, S, target, choice, features);
+}
+
+static void Usage(const char* program) {
+  cerr << "Usage: " << program << " [options] scaleM scaleN files..." << endl
+       << "       " << program << " [options] --serve|--socket=PATH" << endl
+       << "  --format=text|compact|binary|summary  schedule output (default: text)" << endl
+       << "  --output=FILE                         write results to FILE instead of stdout" << endl
+       << "  --quiet                               no diagnostic output of the algorithms" << endl
+       << "  --algorithms=A,B,...                  of lpt, mf, djms, bdjr, exact, portfolio (default: lpt,mf,djms,bdjr)" << endl
+       << "  --target=RATIO                        quality target of portfolio (default: guarantee of the rounding)" << endl
+       << "  --deadline=MS                         best of LPT, MF and BDJR completed within MS" << endl
+       << "  --fftw=estimate|measure|patient       FFTW planner (default: estimate)" << endl
+       << "  --fft-processes=N                     FFT pairs in N processes pinned to sockets, each with a thread per CPU of its share (default: 0, threads)" << endl
+       << "  --wisdom=FILE                         load FFTW wisdom from FILE and store it there" << endl
+       << "  --hugepages=off|transparent|explicit  huge pages for tensors (default: transparent)" << endl
+       << "  --serve                               solve the instances of stdin with BDJR, see server.h" << endl
+       << "  --socket=PATH                         same for the clients of a Unix socket at PATH" << endl
+       << "  --workers=N                           concurrent solves of the server (default: 2)" << endl
+       << "  --rounding=NAME                       rounding of BDJR, one of:";
+  for (auto const& r : BDJR::Roundings()) cerr << " " << r.name;
+  cerr << endl;
+}
+
 int main(int argc, const char* argv[]) {
 
-  nat scaleM = std::atoi(argv[1]);
-  nat scaleN = std::atoi(argv[2]);
+  OutputFormat format = OutputFormat::Text;
+  const char* output = nullptr;
+  bool quiet = false;
+  const char* wisdom = nullptr;
+  set<string> algorithms = {"lpt", "mf", "djms", "bdjr"};
+  bool serve = false;
+  const char* socket_path = nullptr;
+  Server::Options server;
+  vector<const char*> args;
 
-  for (int i = 3; i < argc; i++) {
-    const char* file = argv[i];
+  for (int i = 1; i < argc; i++) {
+    const char* arg = argv[i];
+    if (!strncmp(arg, "--format=", 9)) {
+      if (!ParseOutputFormat(arg + 9, format)) {
+        Usage(argv[0]);
+        return 1;
+      }
+    }
+    else if (!strncmp(arg, "--output=", 9)) output = arg + 9;
+    else if (!strcmp(arg, "--quiet")) quiet = true;
+    else if (!strncmp(arg, "--deadline=", 11)) budget = chrono::milliseconds(atoi(arg + 11));
+    else if (!strncmp(arg, "--rounding=", 11)) {
+      if (!BDJR::SelectRounding(arg + 11)) {
+        Usage(argv[0]);
+        return 1;
+      }
+    }
+    else if (!strncmp(arg, "--fftw=", 7)) {
+      FFT::Planner planner;
+      if (!FFT::ParsePlanner(arg + 7, planner)) {
+        Usage(argv[0]);
+        return 1;
+      }
+      FFT::SetPlanner(planner);
+    }
+    else if (!strncmp(arg, "--wisdom=", 9)) wisdom = arg + 9;
+    else if (!strncmp(arg, "--fft-processes=", 16)) Shard::SetProcesses(atoi(arg + 16));
+    else if (!strncmp(arg, "--hugepages=", 12)) {
+      Memory::HugePages policy;
+      if (!Memory::ParseHugePages(arg + 12, policy)) {
+        Usage(argv[0]);
+        return 1;
+      }
+      Memory::SetHugePages(policy);
+    }
+    else if (!strncmp(arg, "--algorithms=", 13)) {
+      algorithms.clear();
+      string list = string(arg + 13) + ",";
+      for (size_t k = 0, j; (j = list.find(',', k)) != string::npos; k = j + 1) {
+        string name = list.substr(k, j - k);
+        if (name != "lpt" && name != "mf" && name != "djms" && name != "bdjr" && name != "exact" && name != "portfolio") {
+          Usage(argv[0]);
+          return 1;
+        }
+        algorithms.insert(name);
+      }
+    }
+    else if (!strncmp(arg, "--target=", 9)) target = atof(arg + 9);
+    else if (!strcmp(arg, "--serve")) serve = true;
+    else if (!strncmp(arg, "--socket=", 9)) socket_path = arg + 9;
+    else if (!strncmp(arg, "--workers=", 10)) server.workers = max(1, atoi(arg + 10));
+    else if (!strncmp(arg, "--", 2)) {
+      Usage(argv[0]);
+      return 1;
+    }
+    else args.push_back(arg);
+  }
+
+  if (serve || socket_path) {
+    if (wisdom) FFT::ImportWisdom(wisdom);
+    verbose = false; // the solves run concurrently
+    server.format = format;
+    server.budget = budget;
+    bool ok = socket_path ? Server::ServeSocket(socket_path, server) : Server::ServeStream(stdin, stdout, server);
+    if (wisdom && !FFT::ExportWisdom(wisdom)) {
+      cerr << "Cannot write wisdom to " << wisdom << endl;
+    }
+    return ok ? 0 : 1;
+  }
+
+  if (args.size() < 2) {
+    Usage(argv[0]);
+    return 1;
+  }
+
+  nat scaleM = std::atoi(args[0]);
+  nat scaleN = std::atoi(args[1]);
+
+  FILE* file = output ? fopen(output, format == OutputFormat::Binary ? "wb" : "w") : stdout;
+  if (!file) {
+    cerr << "Cannot open " << output << endl;
+    return 1;
+  }
 
-    cout << filesystem::path(file).stem().string() << endl;
+  if (wisdom) FFT::ImportWisdom(wisdom); // a missing file is fine
 
-    Instance I;
-    Schedule S;
+  // Diagnostics would interleave with (or corrupt) anything but the text format
+  verbose = !quiet && format == OutputFormat::Text;
 
-    if (I.Read(file)) {
-      ScaleInstance(I, scaleM, scaleN);
-      cout << I << endl;
+  {
+    ScheduleWriter out(file, format);
+    out.SetAutoFlush(verbose && !output);
 
-      RunExperiment("LPT",  &LPT::ComputeSchedule,  I, S);
-      RunExperiment("MF",   &MF::ComputeSchedule,   I, S);
-      nat djms = RunExperiment("DJMS", &DJMS::ComputeSchedule, I, S);
-      nat bdjr = RunExperiment("BDJR", &BDJR::ComputeSchedule, I, S);
+    // Three stages: the next instances are read while one is solved and
+    // the results of the previous ones are written
+    struct Loaded {
+      string name;
+      Instance I;
+      bool read; // error note instead of results if not
+    };
+    BoundedQueue<Loaded> loaded(kPipelineDepth);
+    BoundedQueue<Records> solved(kPipelineDepth);
 
-      double eps = 0.1754019165039063;
-      if (bdjr > (1+eps)*djms) {
-        cout << "BAD MAKESPAN" << endl;
+    thread reader([&] {
+      for (size_t i = 2; i < args.size(); i++) {
+        Loaded item{filesystem::path(args[i]).stem().string(), Instance(), false};
+        item.read = item.I.Read(args[i]);
+        if (item.read) ScaleInstance(item.I, scaleM, scaleN);
+        else item.name = args[i];
+        loaded.Push(std::move(item));
       }
+      loaded.Close();
+    });
+
+    thread writer;
+    if (!verbose) {
+      writer = thread([&] {
+        Records records;
+        while (solved.Pop(records)) records.WriteTo(out);
+      });
+    }
+
+    Loaded item;
+    while (loaded.Pop(item)) {
+      if (!item.read) {
+        Records out_I(verbose ? &out : nullptr);
+        out_I.Note("ERROR cannot read " + item.name);
+        if (!verbose) solved.Push(std::move(out_I));
+        continue;
+      }
+      auto instance = make_shared<const Instance>(std::move(item.I));
+      const Instance& I = *instance;
+      Records out_I(verbose ? &out : nullptr);
+      out_I.Add([name = item.name, instance](ScheduleWriter& out) { out.BeginInstance(name, *instance); });
+
+      if (algorithms.count("lpt")) RunExperiment("LPT",  &LPT::ComputeSchedule,  I, out_I);
+      if (algorithms.count("mf")) RunExperiment("MF",   &MF::ComputeSchedule,   I, out_I);
+      nat djms = 0, bdjr = 0;
+      if (algorithms.count("djms")) djms = RunExperiment("DJMS", &DJMS::ComputeSchedule, I, out_I);
+      if (algorithms.count("bdjr")) {
+        if (budget.count() > 0) {
+          bdjr = RunExperiment("BDJR", &AnytimeBDJR, I, out_I);
+          out_I.Note(string("BDJR stage: ") + BDJR::StageName(stage));
+        } else {
+          bdjr = RunExperiment("BDJR", &BDJR::ComputeSchedule, I, out_I);
+        }
+      }
+      if (algorithms.count("exact")) {
+        RunExperiment("Exact", &ExactSchedule, I, out_I);
+        if (!proven) out_I.Note("Exact: node limit reached, not proven optimal");
+      }
+      if (algorithms.count("portfolio")) {
+        RunExperiment("Portfolio", &PortfolioSchedule, I, out_I);
+        out_I.Note(string("Portfolio choice: ") + Portfolio::ChoiceName(choice) +
+          " (m=" + to_string(features.m) + " n=" + to_string(features.n) +
+          " distinct=" + to_string(features.distinct) + " lower=" + to_string(features.lower) +
+          " heuristic=" + to_string(features.heuristic) + ")");
+      }
+
+      if (djms > 0 && bdjr > BDJR::SelectedRounding().ratio * djms) {
+        out_I.Note("BAD MAKESPAN");
+      }
+      if (!verbose) solved.Push(std::move(out_I));
     }
+    solved.Close();
+
+    reader.join();
+    if (writer.joinable()) writer.join();
+  }
+
+  if (output) fclose(file);
+
+  if (wisdom && !FFT::ExportWisdom(wisdom)) {
+    cerr << "Cannot write wisdom to " << wisdom << endl;
   }
 
   return 0;
@@ -0,0 +1,65 @@
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <sys/mman.h>
+
+#include "memory.h"
+
+static constexpr std::size_t kHugePage = 1 << 21;
+static constexpr std::size_t kCacheLine = 64;
+
+static std::atomic<Memory::HugePages> huge_pages(Memory::HugePages::Transparent);
+
+bool Memory::ParseHugePages(const std::string& name, HugePages& policy) {
+  if (name == "off") policy = HugePages::Off;
+  else if (name == "transparent") policy = HugePages::Transparent;
+  else if (name == "explicit") policy = HugePages::Explicit;
+  else return false;
+  return true;
+}
+
+void Memory::SetHugePages(HugePages policy) {
+  huge_pages = policy;
+}
+
+static inline std::size_t MappedSize(std::size_t size) {
+  return (size + kHugePage - 1) / kHugePage * kHugePage;
+}
+
+void* Memory::Allocate(std::size_t size) {
+  if (size < kHugePage) {
+    void* p = std::aligned_alloc(kCacheLine, (size + kCacheLine - 1) / kCacheLine * kCacheLine);
+    if (!p) throw std::bad_alloc();
+    return p;
+  }
+
+  std::size_t mapped = MappedSize(size);
+  HugePages policy = huge_pages;
+  void* p = MAP_FAILED;
+#ifdef MAP_HUGETLB
+  if (policy == HugePages::Explicit) {
+    p = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  }
+#endif
+  if (p == MAP_FAILED) {
+    // Transparent huge pages need a huge page aligned block: map one huge
+    // page more and cut off both ends.
+    char* q = (char*)mmap(nullptr, mapped + kHugePage, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (q == MAP_FAILED) throw std::bad_alloc();
+    std::size_t head = (kHugePage - (std::uintptr_t)q % kHugePage) % kHugePage;
+    if (head > 0) munmap(q, head);
+    munmap(q + head + mapped, kHugePage - head);
+    p = q + head;
+#ifdef MADV_HUGEPAGE
+    if (policy != HugePages::Off) madvise(p, mapped, MADV_HUGEPAGE);
+#endif
+  }
+  return p;
+}
+
+void Memory::Free(void* p, std::size_t size) {
+  if (!p) return;
+  if (size < kHugePage) std::free(p);
+  else munmap(p, MappedSize(size));
+}
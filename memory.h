@@ -0,0 +1,36 @@
+#ifndef MEMORY_H_
+#define MEMORY_H_
+
+#include <cstddef>
+#include <string>
+
+/*
+ * Allocation of the large arrays (tensors, FFT buffers). Blocks of at least
+ * a huge page are mapped directly, so that their pages are only placed
+ * when they are first written (first touch): by the threads that work on
+ * them later as far as the first writes follow the same OpenMP schedule.
+ */
+namespace Memory {
+
+  /*
+   * off:         regular pages
+   * transparent: madvise(MADV_HUGEPAGE), the kernel may back the block
+   *              with transparent huge pages (default)
+   * explicit:    MAP_HUGETLB from the reserved huge page pool, falling back
+   *              to transparent ones if the pool is exhausted
+   */
+  enum class HugePages { Off, Transparent, Explicit };
+
+  bool ParseHugePages(const std::string& name, HugePages& policy);
+
+  void SetHugePages(HugePages policy);
+
+  /* Uninitialized, page (or cache line) aligned memory. */
+  void* Allocate(std::size_t size);
+
+  /* size has to be the same as in Allocate. */
+  void Free(void* p, std::size_t size);
+
+}
+
+#endif // MEMORY_H_
@@ -0,0 +1,211 @@
+#include "output.h"
+
+#include <cstring>
+
+using namespace PCmax;
+
+bool PCmax::ParseOutputFormat(const std::string& name, OutputFormat& format) {
+  if (name == "text") format = OutputFormat::Text;
+  else if (name == "compact") format = OutputFormat::Compact;
+  else if (name == "binary") format = OutputFormat::Binary;
+  else if (name == "summary") format = OutputFormat::Summary;
+  else return false;
+  return true;
+}
+
+ScheduleWriter::ScheduleWriter(std::FILE* file, OutputFormat format, std::size_t capacity) :
+  file_(file), format_(format), auto_flush_(false), buffer_(capacity), size_(0)
+{
+  if (format_ == OutputFormat::Binary) Put("BDJR", 4);
+}
+
+ScheduleWriter::~ScheduleWriter() {
+  Flush();
+}
+
+void ScheduleWriter::Flush() {
+  if (size_ > 0) std::fwrite(buffer_.data(), 1, size_, file_);
+  size_ = 0;
+  std::fflush(file_);
+}
+
+void ScheduleWriter::Put(const char* s, std::size_t len) {
+  if (size_ + len > buffer_.size()) {
+    std::fwrite(buffer_.data(), 1, size_, file_);
+    size_ = 0;
+    if (len > buffer_.size()) {
+      std::fwrite(s, 1, len, file_);
+      return;
+    }
+  }
+  std::memcpy(buffer_.data() + size_, s, len);
+  size_ += len;
+}
+
+void ScheduleWriter::Put(const char* s) {
+  Put(s, std::strlen(s));
+}
+
+void ScheduleWriter::Put(char c) {
+  if (size_ == buffer_.size()) {
+    std::fwrite(buffer_.data(), 1, size_, file_);
+    size_ = 0;
+  }
+  buffer_[size_++] = c;
+}
+
+void ScheduleWriter::PutNat(nat x) {
+  char digits[20];
+  int len = 0;
+  do {
+    digits[len++] = '0' + x % 10;
+    x /= 10;
+  } while (x > 0);
+  while (len > 0) Put(digits[--len]);
+}
+
+void ScheduleWriter::PutU64(std::uint64_t x) {
+  char bytes[8];
+  for (int i = 0; i < 8; ++i) bytes[i] = (x >> (8*i)) & 0xFF;
+  Put(bytes, 8);
+}
+
+void ScheduleWriter::PutString(const char* s, std::size_t len) {
+  PutU64(len);
+  Put(s, len);
+}
+
+void ScheduleWriter::EndRecord() {
+  if (format_ != OutputFormat::Binary) Put('\n');
+  if (auto_flush_) Flush();
+}
+
+void ScheduleWriter::BeginInstance(const std::string& name, const Instance& I) {
+  const auto& jobs = I.GetMap();
+  switch (format_) {
+    case OutputFormat::Text:
+      Put(name.data(), name.size());
+      Put('\n');
+      Put("Instance[m = ");
+      PutNat(I.GetM());
+      Put(", jobs (processing time, amount): ");
+      for (auto j = jobs.begin(); j != jobs.end(); ++j) {
+        Put('(');
+        PutNat(j->first);
+        Put(", ");
+        PutNat(j->second);
+        Put(')');
+        if (std::next(j) != jobs.end()) Put(", ");
+      }
+      Put(']');
+      break;
+    case OutputFormat::Compact:
+    case OutputFormat::Summary:
+      Put(name.data(), name.size());
+      Put(" m=");
+      PutNat(I.GetM());
+      Put(" n=");
+      PutNat(I.GetN());
+      break;
+    case OutputFormat::Binary:
+      Put('I');
+      PutString(name.data(), name.size());
+      PutU64(I.GetM());
+      PutU64(jobs.size());
+      for (auto const& j : jobs) {
+        PutU64(j.first);
+        PutU64(j.second);
+      }
+      break;
+  }
+  EndRecord();
+}
+
+void ScheduleWriter::WriteResult(const char* algorithm, nat makespan, nat ms, bool ok, const Schedule& S) {
+  if (format_ == OutputFormat::Binary) {
+    Put('R');
+    PutString(algorithm, std::strlen(algorithm));
+    PutU64(makespan);
+    PutU64(ms);
+    Put((char)ok);
+    WriteBinarySchedule(S);
+    EndRecord();
+    return;
+  }
+
+  Put(algorithm);
+  Put(": ");
+  PutNat(makespan);
+  Put(' ');
+  PutNat(ms);
+  Put(' ');
+  Put(ok ? "ok" : "FAIL");
+  if (format_ == OutputFormat::Text) WriteTextSchedule(S);
+  if (format_ == OutputFormat::Compact) WriteCompactSchedule(S);
+  EndRecord();
+}
+
+void ScheduleWriter::WriteNote(const char* note) {
+  if (format_ == OutputFormat::Binary) {
+    Put('N');
+    PutString(note, std::strlen(note));
+  } else {
+    Put(note);
+  }
+  EndRecord();
+}
+
+/*
+ * Same output as operator<<(std::ostream&, const Schedule&).
+ */
+void ScheduleWriter::WriteTextSchedule(const Schedule& S) {
+  Put('[');
+  nat i = 0;
+  for (auto const& conf : S) {
+    Put('(');
+    nat j = 0;
+    for (nat job : conf) {
+      PutNat(job);
+      if (++j < conf.size()) Put(',');
+    }
+    Put(')');
+    if (++i < S.size()) Put(',');
+  }
+  Put(']');
+}
+
+void ScheduleWriter::WriteCompactSchedule(const Schedule& S) {
+  nat u = 0;
+  for (auto const& conf : S) {
+    Put('\n');
+    PutNat(u++);
+    Put(':');
+    for (nat j = 0; j < conf.size(); ) {
+      nat k = j + 1;
+      while (k < conf.size() && conf[k] == conf[j]) ++k;
+      Put(' ');
+      PutNat(conf[j]);
+      Put('x');
+      PutNat(k - j);
+      j = k;
+    }
+  }
+}
+
+void ScheduleWriter::WriteBinarySchedule(const Schedule& S) {
+  PutU64(S.size());
+  for (auto const& conf : S) {
+    nat runs = 0;
+    for (nat j = 0; j < conf.size(); ++j) {
+      if (j == 0 || conf[j] != conf[j-1]) ++runs;
+    }
+    PutU64(runs);
+    for (nat j = 0; j < conf.size(); ) {
+      nat k = j + 1;
+      while (k < conf.size() && conf[k] == conf[j]) ++k;
+      PutU64(conf[j]);
+      PutU64(k - j);
+      j = k;
+    }
+  }
+}
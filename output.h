@@ -0,0 +1,77 @@
+#ifndef OUTPUT_H_
+#define OUTPUT_H_
+
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "pcmax.h"
+
+namespace PCmax {
+
+/*
+ * text:    instance dump and every schedule as [(p,p,...),(...),...]
+ * compact: one line per machine with run-lengths "u: p x count ..."
+ * binary:  length-prefixed little-endian records, see ScheduleWriter
+ * summary: algorithm, makespan and running time only
+ */
+enum class OutputFormat { Text, Compact, Binary, Summary };
+
+bool ParseOutputFormat(const std::string& name, OutputFormat& format);
+
+/*
+ * Writes experiment results through a large buffer which is only handed to
+ * the underlying file when it is full, on Flush() and on destruction.
+ *
+ * The binary format starts with the magic "BDJR" followed by records, each
+ * introduced by a one byte tag. All integers are uint64 little-endian and
+ * strings are prefixed by their length:
+ *   'I' name m d (p a)^d                       instance with d distinct sizes
+ *   'R' algorithm makespan ms ok machines (runs (p count)^runs)^machines
+ *   'N' text                                   note
+ */
+class ScheduleWriter {
+ public:
+  ScheduleWriter(std::FILE* file, OutputFormat format, std::size_t capacity = 1 << 22);
+  ~ScheduleWriter();
+
+  ScheduleWriter(const ScheduleWriter&) = delete;
+  ScheduleWriter& operator=(const ScheduleWriter&) = delete;
+
+  void BeginInstance(const std::string& name, const Instance& I);
+
+  void WriteResult(const char* algorithm, nat makespan, nat ms, bool ok, const Schedule& S);
+
+  void WriteNote(const char* note);
+
+  /* Hand the buffer over after every record, e.g. to interleave with LOG. */
+  void SetAutoFlush(bool auto_flush) {
+    auto_flush_ = auto_flush;
+  }
+
+  void Flush();
+
+ private:
+  void Put(const char* s, std::size_t len);
+  void Put(const char* s);
+  void Put(char c);
+  void PutNat(nat x);
+  void PutU64(std::uint64_t x);
+  void PutString(const char* s, std::size_t len);
+  void EndRecord();
+
+  void WriteTextSchedule(const Schedule& S);
+  void WriteCompactSchedule(const Schedule& S);
+  void WriteBinarySchedule(const Schedule& S);
+
+  std::FILE* file_;
+  OutputFormat format_;
+  bool auto_flush_;
+  std::vector<char> buffer_;
+  std::size_t size_;
+};
+
+}
+
+#endif // OUTPUT_H_
@@ -86,6 +86,15 @@ class Schedule : public std::vector<std::vector<nat>> {
     at(machine).push_back(load);
   }
 
+  /*
+   * Adds count jobs of size load. The machine stores each of them, the
+   * compact output finds the run again.
+   */
+  void AddLoads(nat machine, nat load, nat count) {
+    if (size() <= machine) resize(machine+1);
+    at(machine).insert(at(machine).end(), count, load);
+  }
+
   bool IsFeasibleForInstance(const Instance& I) {
     if (size() > I.GetM()) return false;
     std::map<nat,nat> jobs(I.GetMap()); // copy
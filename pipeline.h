@@ -0,0 +1,65 @@
+#ifndef PIPELINE_H_
+#define PIPELINE_H_
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <queue>
+
+namespace PCmax {
+
+/*
+ * Queue between the stages of a pipeline (or a producer and its workers).
+ * Push blocks while capacity items are queued, so a fast stage runs at
+ * most capacity items ahead. Pop blocks until there is an item and returns
+ * false once the queue is closed and drained.
+ */
+template<class T>
+class BoundedQueue {
+ public:
+  explicit BoundedQueue(std::size_t capacity) : capacity_(std::max<std::size_t>(1, capacity)), closed_(false) {}
+
+  BoundedQueue(const BoundedQueue&) = delete;
+  BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+  void Push(T item) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    space_.wait(lock, [this] { return items_.size() < capacity_; });
+    items_.push(std::move(item));
+    lock.unlock();
+    ready_.notify_one();
+  }
+
+  bool Pop(T& item) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      ready_.wait(lock, [this] { return closed_ || !items_.empty(); });
+      if (items_.empty()) return false;
+      item = std::move(items_.front());
+      items_.pop();
+    }
+    space_.notify_one();
+    return true;
+  }
+
+  /* No more items, Pop returns false once the queued ones are taken. */
+  void Close() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      closed_ = true;
+    }
+    ready_.notify_all();
+  }
+
+ private:
+  std::size_t capacity_;
+  bool closed_;
+  std::mutex mutex_;
+  std::condition_variable ready_, space_;
+  std::queue<T> items_;
+};
+
+}
+
+#endif // PIPELINE_H_
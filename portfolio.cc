@@ -0,0 +1,73 @@
+#include "portfolio.h"
+
+#include <algorithm>
+
+#include "heuristic.h"
+#include "bounds.h"
+#include "exact.h"
+#include "bdjr.h"
+
+using namespace PCmax;
+
+// Instances up to this many jobs are tried exactly first
+static constexpr nat kExactJobs = 64;
+static constexpr std::size_t kExactNodes = std::size_t(1) << 20;
+
+const char* Portfolio::ChoiceName(Choice choice) {
+  switch (choice) {
+    case Choice::Exact: return "exact";
+    case Choice::LPT: return "LPT";
+    case Choice::MF: return "MF";
+    case Choice::BDJR: return "BDJR";
+  }
+  return "";
+}
+
+nat Portfolio::ComputeSchedule(const Instance& I, Schedule& S, double target, Choice& choice, Features& features) {
+  if (target <= 0) target = BDJR::SelectedRounding().ratio;
+  target = std::max(target, 1.0);
+
+  features.m = I.GetM();
+  features.n = I.GetN();
+  features.distinct = I.GetMap().size();
+
+  Schedule S_lpt, S_mf;
+  nat u_lpt = LPT::ComputeSchedule(I, S_lpt);
+  nat u_mf = MF::ComputeSchedule(I, S_mf);
+  features.heuristic = std::min(u_lpt, u_mf);
+  features.lower = Bounds::LowerBound(I, features.heuristic);
+
+  if (features.heuristic <= target * features.lower) {
+    choice = u_mf < u_lpt ? Choice::MF : Choice::LPT;
+    S.swap(u_mf < u_lpt ? S_mf : S_lpt);
+    return features.heuristic;
+  }
+
+  if (features.n <= kExactJobs) {
+    Schedule S_;
+    bool proven;
+    nat u = Exact::ComputeSchedule(I, S_, kExactNodes, proven, u_mf < u_lpt ? S_mf : S_lpt, features.heuristic);
+    if (proven) {
+      choice = Choice::Exact;
+      S.swap(S_);
+      return u;
+    }
+  }
+
+  Schedule S_;
+  nat u = BDJR::ComputeSchedule(I, S_);
+  if (u > 0 && u <= features.heuristic) {
+    choice = Choice::BDJR;
+    S.swap(S_);
+    return u;
+  }
+  choice = u_mf < u_lpt ? Choice::MF : Choice::LPT;
+  S.swap(u_mf < u_lpt ? S_mf : S_lpt);
+  return features.heuristic;
+}
+
+nat Portfolio::ComputeSchedule(const Instance& I, Schedule& S) {
+  Choice choice;
+  Features features;
+  return ComputeSchedule(I, S, 0, choice, features);
+}
@@ -0,0 +1,40 @@
+#ifndef PORTFOLIO_H_
+#define PORTFOLIO_H_
+
+#include "pcmax.h"
+
+namespace PCmax {
+
+  namespace Portfolio {
+
+    enum class Choice { Exact, LPT, MF, BDJR };
+
+    const char* ChoiceName(Choice choice);
+
+    /*
+     * Features the choice is based on. lower is Bounds::LowerBound and
+     * heuristic the better makespan of LPT and MF.
+     */
+    struct Features {
+      nat m, n, distinct;
+      nat lower, heuristic;
+    };
+
+    /*
+     * Solves I (into an empty S) by the cheapest algorithm that meets the
+     * quality target, a makespan of at most target times the optimum:
+     *   LPT/MF if their makespan is within target of the lower bound
+     *   Exact  for at most kExactJobs jobs, if it finishes in its node limit
+     *   BDJR   (selected rounding) otherwise, unless LPT/MF is better
+     * target 0 uses the guarantee of the selected rounding, a target below 1
+     * is 1. Exact starts from the better schedule of LPT and MF.
+     */
+    nat ComputeSchedule(const Instance& I, Schedule& S, double target, Choice& choice, Features& features);
+
+    /* Same as above with the default target. */
+    nat ComputeSchedule(const Instance& I, Schedule& S);
+  }
+
+}
+
+#endif // PORTFOLIO_H_
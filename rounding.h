@@ -64,7 +64,7 @@ class Rounding10 : public Rounding {
 
   static constexpr int Size(int i) {
     // SIZES[] = {12, 12 + 2, 12 + 4, 12 + 6, 12 + 9, 24, 24 + 4, 24 + 8, 24 + 12, 24 + 18};
-    return i <= 3 ? 12 + 2 * i : (i == 4 ? 12 + 9 : (i <= 8 ? 24 + 4 * i : 24 + 18));
+    return i <= 3 ? 12 + 2 * i : (i == 4 ? 12 + 9 : (i <= 8 ? 24 + 4 * (i - 5) : 24 + 18));
   }
 
   static constexpr int MaxL1Norm() { return 3; }
@@ -110,6 +110,35 @@ class CheapPaddedRounding : public R {
 
 };
 
+/*
+ * Index of the largest size of R that does not exceed p (normalized to a
+ * makespan of 1), or R::Dim() if p is smaller than every size.
+ */
+template<class R>
+constexpr int RoundedIndex(double p) {
+  int best = R::Dim();
+  for (int i = 0; i < R::Dim(); ++i) {
+    if (p >= R::Size(i) / (double)R::Makespan()) {
+      if (best == R::Dim() || R::Size(i) > R::Size(best)) best = i;
+    }
+  }
+  return best;
+}
+
+/*
+ * The smallest normalized size of R: jobs up to eps are small, jobs of at
+ * least 1-2*eps are huge and the jobs in between are rounded.
+ */
+template<class R>
+constexpr double Epsilon() {
+  double eps = 1.0;
+  for (int i = 0; i < R::Dim(); ++i) {
+    double s = R::Size(i) / (double)R::Makespan();
+    if (s < eps) eps = s;
+  }
+  return eps;
+}
+
 
 #define ROUNDINGS_LIST_HELPER(X, R) \
   X(R) \
@@ -128,4 +157,29 @@ class CheapPaddedRounding : public R {
   ROUNDINGS_LIST_HELPER(X, ArithmeticRounding<8>) \
   ROUNDINGS_LIST_HELPER(X, ArithmeticRounding<9>)
 
+// Roundings without the padded variants
+#define UNPADDED_ROUNDINGS_LIST(X) \
+  X(Rounding9<0>) \
+  X(Rounding10<0>) \
+  X(ArithmeticRounding<1>) \
+  X(ArithmeticRounding<2>) \
+  X(ArithmeticRounding<3>) \
+  X(ArithmeticRounding<4>) \
+  X(ArithmeticRounding<5>) \
+  X(ArithmeticRounding<6>) \
+  X(ArithmeticRounding<7>) \
+  X(ArithmeticRounding<8>) \
+  X(ArithmeticRounding<9>)
+
+// Roundings BDJR can be run with (huge jobs can only be paired if eps < 1/4)
+#define BDJR_ROUNDINGS_LIST(X) \
+  X(Rounding9<0>, "rounding9") \
+  X(Rounding10<0>, "rounding10") \
+  X(ArithmeticRounding<4>, "arithmetic4") \
+  X(ArithmeticRounding<5>, "arithmetic5") \
+  X(ArithmeticRounding<6>, "arithmetic6") \
+  X(ArithmeticRounding<7>, "arithmetic7") \
+  X(ArithmeticRounding<8>, "arithmetic8") \
+  X(ArithmeticRounding<9>, "arithmetic9")
+
 #endif
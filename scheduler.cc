@@ -1,9 +1,54 @@
 #include <iostream>
 #include <algorithm>
 #include <map>
+#include <mutex>
+#include <unordered_map>
 
 #include "convolution.h"
 #include "scheduler.h"
+#include "interrupt.h"
+#include "log.h"
+
+template<class R>
+struct VectorHash {
+  std::size_t operator()(const Vector<R>& b) const {
+    std::size_t h = 14695981039346656037ULL;
+    for (int i = 0; i < R::Dim(); ++i) h = (h ^ (unsigned)b[i]) * 1099511628211ULL;
+    return h;
+  }
+};
+
+template<class R>
+struct MinMachinesCache {
+  std::mutex mutex;
+  std::unordered_map<Vector<R>, int, VectorHash<R>> results;
+};
+
+template<class R, class C>
+int Scheduler<R, C>::MinMachines(const Vector<R>& b) {
+  if (b.IsZero()) return 0;
+  if (b.ScaledVolume() <= Vector<R>::Scaled(R::Makespan() - R::Precision())) return 1;
+
+  static MinMachinesCache<R> cache;
+  if (cached_min_machines > 0) {
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    auto it = cache.results.find(b);
+    if (it != cache.results.end()) return it->second;
+  }
+
+  auto t = TensorPool<R>::Acquire(), t_ = TensorPool<R>::Acquire();
+  Vector<R> s;
+  s.Reset();
+  MinMachines(*t, *t_, b);
+  int m = t->Get(s);
+
+  if (cached_min_machines > 0 && !Interrupt::Requested()) { // incomplete otherwise
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    if (cache.results.size() >= cached_min_machines) cache.results.clear();
+    cache.results.emplace(b, m);
+  }
+  return m;
+}
 
 template<class R, class C>
 void Scheduler<R, C>::MinMachines(Tensor<R>& t, Tensor<R>& trash, const Vector<R>& anchor) {
@@ -12,37 +57,70 @@ void Scheduler<R, C>::MinMachines(Tensor<R>& t, Tensor<R>& trash, const Vector<R
     anchor_[i] = R::PreviousInterval(i, anchor[i]);
   }
   if (anchor == anchor_) {
-    // Repeat until nothing changes
+    // Repeat until nothing changes; then t and trash are equal
     t.Initialize(anchor_);
-    while (1) {
-      C::Square(trash, t, anchor, anchor_);
-      if (t == trash) break;
-      C::Square(t, trash, anchor, anchor_);
-      if (t == trash) break;
+    for (int round = 1; !Interrupt::Requested(); ++round) {
+      std::size_t changed = C::Square(trash, t, anchor, anchor_);
+      LOG << "round " << round << ": " << changed << " entries changed" << std::endl;
+      t.swap(trash);
+      if (changed == 0) break;
     }
   } else {
     MinMachines(trash, t, anchor_);
+    if (Interrupt::Requested()) return;
     C::Square(t, trash, anchor, anchor_);
   }
 }
 
+/*
+ * count identical targets (b, m) which are split alike.
+ */
+template<class R>
+struct Target {
+  Vector<R> b;
+  int m;
+  int count;
+};
+
+template<class R>
+void AddTarget(std::vector<Target<R>>& targets, const Vector<R>& b, int m, int count) {
+  for (auto& t : targets) {
+    if (t.m == m && t.b == b) {
+      t.count += count;
+      return;
+    }
+  }
+  targets.push_back(Target<R>{b, m, count});
+}
+
+template<class R>
+void AddConfiguration(Configurations<R>& S, const Vector<R>& c, int count) {
+  for (auto& s : S) {
+    if (s.first == c) {
+      s.second += count;
+      return;
+    }
+  }
+  S.emplace_back(c, count);
+}
+
 template<class R>
-std::vector<std::pair<Vector<R>,int>> Backtrace(const Vector<R>& anchor, const Tensor<R>& t, const std::vector<std::pair<Vector<R>,int>>& targets, std::vector<Vector<R>>& S) {
+std::vector<Target<R>> Backtrace(const Vector<R>& anchor, const Tensor<R>& t, const std::vector<Target<R>>& targets, Configurations<R>& S) {
 
-  std::vector<std::pair<Vector<R>,int>> new_targets;
+  std::vector<Target<R>> new_targets;
 
-  //#pragma omp parallel for
   for (const auto& target : targets) {
-    const Vector<R>& b = target.first;
-    int m = target.second;
+    if (Interrupt::Requested()) return {};
+    const Vector<R>& b = target.b;
+    int m = target.m;
 
-    std::cout << "target b = " << b  << ", m = " << m  << std::endl;
+    LOG << "target b = " << b  << ", m = " << m  << ", count = " << target.count << std::endl;
 
     Vector<R> b1 = b, b2 = b;
     int m1 = m, m2 = m, bestdiff = m+1;
 
-    //#pragma omp for nowait
     for (std::size_t i = 0; i < Tensor<R>::data_size(); ++i) {
+      if ((i & 0xFFFF) == 0 && Interrupt::Requested()) return {};
       Vector<R> a1;
       Tensor<R>::FromIndex(a1, i);
       int v1 = t.Get(a1);
@@ -54,6 +132,7 @@ std::vector<std::pair<Vector<R>,int>> Backtrace(const Vector<R>& anchor, const T
 
       Vector<R> a_2 = b;
       a_2 -= a_1; // => a_1 + a_2 = b
+      if (a_2.IsZero()) continue; // b = b + 0 makes no progress
 
       Vector<R> a2 = a_2;
       a2 -= anchor;
@@ -74,28 +153,22 @@ std::vector<std::pair<Vector<R>,int>> Backtrace(const Vector<R>& anchor, const T
     }
 
     if (bestdiff == m+1) {
-      std::cout << "Failed to resolve " << b << std::endl;
+      std::cerr << "Failed to resolve " << b << std::endl;
       continue;
     }
 
-    std::cout << "new target b1 = " << b1 << ", m1 = " << m1 << std::endl;
-    std::cout << "new target b2 = " << b2 << ", m2 = " << m2 << std::endl;
-
-    std::pair<Vector<R>,int> t1(b1, m1);
-    std::pair<Vector<R>,int> t2(b2, m2);
+    LOG << "new target b1 = " << b1 << ", m1 = " << m1 << std::endl;
+    LOG << "new target b2 = " << b2 << ", m2 = " << m2 << std::endl;
 
-    //#pragma omp critical
-    {
-      new_targets.push_back(t1);
-      new_targets.push_back(t2);
-    }
+    AddTarget(new_targets, b1, m1, target.count);
+    AddTarget(new_targets, b2, m2, target.count);
   }
 
-  std::vector<std::pair<Vector<R>,int>> nontrivial_targets;
+  std::vector<Target<R>> nontrivial_targets;
 
   for (const auto& target : new_targets) {
-    if (target.first.L1Norm() <= R::MaxL1Norm() && target.second <= 1) {
-      S.push_back(target.first);
+    if (target.b.L1Norm() <= R::MaxL1Norm() && target.m <= 1) {
+      AddConfiguration(S, target.b, target.count);
     } else {
       nontrivial_targets.push_back(target);
     }
@@ -104,27 +177,35 @@ std::vector<std::pair<Vector<R>,int>> Backtrace(const Vector<R>& anchor, const T
   return nontrivial_targets;
 }
 
+/*
+ * A replacement column c with c[i] = -1 is merged into machines which run a
+ * job of class i. Each merge takes as many machines of a configuration as
+ * are still needed, splitting the configuration if it has more.
+ */
 template<class R>
-void RemoveReplacementColumns(std::vector<Vector<R>>& S) {
-  for (auto& c : S) {
-    for (int i = 0; i < R::Dim(); ++i) if (c[i] == -1) {
-      for (auto& c_ : S) if (&c_ != &c) {
-        if (c_[i] >= 1) {
-          c_ += c;
-          c.Reset(); // c = zero column
-          goto checkNextColumn;
+void RemoveReplacementColumns(Configurations<R>& S) {
+  for (std::size_t k = 0; k < S.size(); ++k) {
+    for (int i = 0; i < R::Dim(); ++i) if (S[k].first[i] == -1) {
+      for (std::size_t l = 0; l < S.size() && S[k].second > 0; ++l) if (l != k) {
+        if (S[l].first[i] >= 1 && S[l].second > 0) {
+          int merged = std::min(S[k].second, S[l].second);
+          Vector<R> c_ = S[l].first;
+          c_ += S[k].first;
+          S[k].second -= merged;
+          S[l].second -= merged;
+          AddConfiguration(S, c_, merged); // may reallocate S
         }
       }
+      if (S[k].second == 0) break;
     }
-    checkNextColumn:;
   }
 
-  // remove zero columns
+  // remove zero columns and exhausted configurations
   S.erase(
     std::remove_if(
       S.begin(),
       S.end(),
-      [](auto const & c) { return c.IsZero(); }
+      [](auto const & c) { return c.first.IsZero() || c.second == 0; }
     ),
     S.end()
   );
@@ -138,28 +219,30 @@ inline void PreviousAnchor(Vector<R>& anchor) {
 }
 
 template<class R, class C>
-void Scheduler<R, C>::ComputeSchedule(const Vector<R>& b, int m, std::vector<Vector<R>>& S) {
+void Scheduler<R, C>::ComputeSchedule(const Vector<R>& b, int m, Configurations<R>& S) {
 
   if (b.IsZero()) return;
-  if (m == 1) S.push_back(b);
+  if (m == 1) S.emplace_back(b, 1);
   if (m <= 1) return;
 
   Vector<R> anchor = b;
-  std::vector<std::pair<Vector<R>,int>> targets;
-  targets.push_back(std::pair<Vector<R>,int>(b, m));
+  std::vector<Target<R>> targets;
+  targets.push_back(Target<R>{b, m, 1});
 
   Vector<R> anchor_;
   anchor_.Reset();
 
-  Tensor<R> t, t_;
+  auto lease = TensorPool<R>::Acquire(), lease_ = TensorPool<R>::Acquire();
+  Tensor<R>& t = *lease;
+  Tensor<R>& t_ = *lease_;
 
-  while (!targets.empty()) {
+  while (!targets.empty() && !Interrupt::Requested()) {
 
     if (anchor != anchor_) {
 
       PreviousAnchor(anchor);
 
-      std::cout << "anchor = " << anchor << std::endl;
+      LOG << "anchor = " << anchor << std::endl;
 
       t.Reset();
       t_.Reset();
@@ -171,13 +254,16 @@ void Scheduler<R, C>::ComputeSchedule(const Vector<R>& b, int m, std::vector<Vec
 
       PreviousAnchor(anchor);
 
-      std::cout << "anchor = " << anchor << std::endl;
+      LOG << "anchor = " << anchor << std::endl;
     }
 
     targets = Backtrace(anchor, t_, targets, S);
   }
 
-  for (auto& c : S) std::cout << c << ", "; std::cout << std::endl;
+  if (verbose) {
+    for (auto& c : S) std::cout << c.first << " x " << c.second << ", ";
+    std::cout << std::endl;
+  }
 
   RemoveReplacementColumns(S);
 }
@@ -186,5 +272,15 @@ void Scheduler<R, C>::ComputeSchedule(const Vector<R>& b, int m, std::vector<Vec
   template class Scheduler<R, NaiveConvolution<R>>; \
   template class Scheduler<R, ParallelNaiveConvolution<R>>; \
   template class Scheduler<R, FFTConvolution<R>>; \
-  template class Scheduler<R, DoubleCheckConvolution<R, FFTConvolution<R>, ParallelNaiveConvolution<R>>>;
+  template class Scheduler<R, ShardedFFTConvolution<R>>; \
+  template class Scheduler<R, DoubleCheckConvolution<R, ShardedFFTConvolution<R>, ParallelNaiveConvolution<R>>>; \
+  template class Scheduler<R, DoubleCheckConvolution<R, FFTConvolution<R>, ParallelNaiveConvolution<R>>>; \
+  template class Scheduler<R, DoubleCheckConvolution<R, BlockedConvolution<R>, ParallelNaiveConvolution<R>>>; \
+  template class Scheduler<R, BlockedConvolution<R>>; \
+  template class Scheduler<R, AutoConvolution<R>>;
 ROUNDINGS_LIST(INSTANTIATE_SCHEDULER)
+
+#define INSTANTIATE_NTT_SCHEDULER(R) \
+  template class Scheduler<R, NTTConvolution<R>>; \
+  template class Scheduler<R, DoubleCheckConvolution<R, NTTConvolution<R>, ParallelNaiveConvolution<R>>>;
+UNPADDED_ROUNDINGS_LIST(INSTANTIATE_NTT_SCHEDULER)
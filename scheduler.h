@@ -1,28 +1,39 @@
 #ifndef SCHEDULER_H_
 #define SCHEDULER_H_
 
+#include <utility>
 #include <vector>
 
 #include "vector.h"
 #include "rounding.h"
 #include "tensor.h"
 
+/*
+ * A schedule of rounded jobs as distinct configurations, each with the
+ * number of machines that run it.
+ */
+template<class R>
+using Configurations = std::vector<std::pair<Vector<R>, int>>;
+
+/*
+ * Number of results of Scheduler::MinMachines(b) kept per scheduler for
+ * processes that solve many similar instances (see server.h), 0 disables
+ * the cache. The cache is cleared when it is full.
+ */
+inline std::size_t cached_min_machines = 0;
+
 template<class R, class C>
 class Scheduler {
  public:
-  static int MinMachines(const Vector<R>& b) {
-    if (b.IsZero()) return 0;
-    if (b.Volume() <= R::Makespan() - R::Precision()) return 1;
-    Tensor<R> t, t_;
-    Vector<R> s;
-    s.Reset();
-    MinMachines(t, t_, b);
-    return t.Get(s);
-  }
+  /*
+   * Minimum number of machines for the rounded jobs b. With
+   * cached_min_machines > 0, results are kept for later calls.
+   */
+  static int MinMachines(const Vector<R>& b);
 
   static void MinMachines(Tensor<R>& t, Tensor<R>& trash, const Vector<R>& anchor);
 
-  static void ComputeSchedule(const Vector<R>& b, int m, std::vector<Vector<R>>& S);
+  static void ComputeSchedule(const Vector<R>& b, int m, Configurations<R>& S);
 };
 
 #endif
@@ -0,0 +1,281 @@
+#include "server.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <csignal>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <omp.h>
+
+#include "pcmax.h"
+#include "bdjr.h"
+#include "scheduler.h"
+#include "pipeline.h"
+
+using namespace PCmax;
+
+namespace {
+
+/*
+ * Fixed set of threads solving the submitted jobs. Submit blocks while
+ * `capacity` jobs are waiting, so that a fast sender cannot queue up
+ * unbounded memory. The OpenMP threads are split among the workers.
+ */
+class Workers {
+ public:
+  Workers(int workers, std::size_t capacity) : jobs_(capacity) {
+    int threads = std::max(1, omp_get_max_threads() / workers);
+    for (int i = 0; i < workers; ++i) {
+      threads_.emplace_back([this, threads] {
+        omp_set_num_threads(threads);
+        std::function<void()> job;
+        while (jobs_.Pop(job)) job();
+      });
+    }
+  }
+
+  /* Finishes all submitted jobs. */
+  ~Workers() {
+    jobs_.Close();
+    for (auto& t : threads_) t.join();
+  }
+
+  void Submit(std::function<void()> job) {
+    jobs_.Push(std::move(job));
+  }
+
+ private:
+  BoundedQueue<std::function<void()>> jobs_;
+  std::vector<std::thread> threads_;
+};
+
+/*
+ * Responses of one client. It lives until its last request is answered,
+ * then the output is flushed and closed (if owned).
+ */
+struct Connection {
+  struct File {
+    std::FILE* file;
+    bool owned;
+    ~File() {
+      if (owned) std::fclose(file);
+    }
+  };
+
+  Connection(std::FILE* file, bool owned, OutputFormat format) :
+    file{file, owned}, out(file, format)
+  {
+    out.SetAutoFlush(true);
+  }
+
+  File file; // closed after out is flushed
+  std::mutex mutex;
+  ScheduleWriter out;
+};
+
+enum class Request { Ok, End, Error };
+
+bool ReadU64(std::FILE* in, std::uint64_t& x) {
+  unsigned char bytes[8];
+  if (std::fread(bytes, 1, 8, in) != 8) return false;
+  x = 0;
+  for (int i = 0; i < 8; ++i) x |= (std::uint64_t)bytes[i] << (8*i);
+  return true;
+}
+
+bool ReadNat(std::FILE* in, nat& x) {
+  int c;
+  while ((c = getc_unlocked(in)) != EOF && std::isspace(c)) {}
+  if (c == EOF || !std::isdigit(c)) return false;
+  x = 0;
+  do {
+    x = 10 * x + (c - '0');
+  } while ((c = getc_unlocked(in)) != EOF && std::isdigit(c));
+  if (c != EOF) ungetc(c, in);
+  return true;
+}
+
+Request ReadText(std::FILE* in, Instance& I, const char*& error) {
+  nat m, n, p;
+  if (!ReadNat(in, m) || !ReadNat(in, n)) {
+    error = "expected m and n";
+    return Request::Error;
+  }
+  I.SetM(m);
+  auto& jobs = I.GetMap();
+  for (nat j = 0; j < n; ++j) {
+    if (!ReadNat(in, p)) {
+      error = "expected n processing times";
+      return Request::Error;
+    }
+    ++jobs[p];
+  }
+  return Request::Ok;
+}
+
+Request ReadBinary(std::FILE* in, std::string& name, Instance& I, const char*& error) {
+  std::uint64_t len, m, d, p, a;
+  error = "truncated binary instance";
+  if (!ReadU64(in, len)) return Request::Error;
+  if (len > (1 << 16)) {
+    error = "name too long";
+    return Request::Error;
+  }
+  name.resize(len);
+  if (std::fread(&name[0], 1, len, in) != len) return Request::Error;
+  if (!ReadU64(in, m) || !ReadU64(in, d)) return Request::Error;
+  I.SetM(m);
+  auto& jobs = I.GetMap();
+  for (std::uint64_t j = 0; j < d; ++j) {
+    if (!ReadU64(in, p) || !ReadU64(in, a)) return Request::Error;
+    jobs[p] += a;
+  }
+  return Request::Ok;
+}
+
+Request ReadRequest(std::FILE* in, nat index, std::string& name, Instance& I, const char*& error) {
+  I.Clear();
+  while (true) {
+    int c;
+    while ((c = getc_unlocked(in)) != EOF && std::isspace(c)) {}
+    if (c == EOF) return Request::End;
+
+    Request r;
+    if (c == 'B') { // magic
+      char magic[3];
+      if (std::fread(magic, 1, 3, in) == 3 && !std::memcmp(magic, "DJR", 3)) continue;
+      error = "expected BDJR";
+      return Request::Error;
+    } else if (c == 'I') {
+      r = ReadBinary(in, name, I, error);
+    } else if (std::isdigit(c)) {
+      ungetc(c, in);
+      name = "#" + std::to_string(index);
+      r = ReadText(in, I, error);
+    } else {
+      error = "expected a PSMF or binary instance";
+      return Request::Error;
+    }
+    if (r == Request::Ok && (I.GetM() == 0 || I.GetMap().empty())) {
+      error = "empty instance";
+      return Request::Error;
+    }
+    if (r == Request::Ok && I.GetMap().begin()->first == 0) {
+      error = "job of size 0";
+      return Request::Error;
+    }
+    return r;
+  }
+}
+
+void Solve(const Server::Options& options, Connection& c, const std::string& name, const Instance& I) {
+  Schedule S;
+  BDJR::Stage stage = BDJR::Stage::BDJR;
+
+  auto start = std::chrono::steady_clock::now();
+  nat makespan = options.budget.count() > 0 ?
+    BDJR::ComputeSchedule(I, S, options.budget, stage) : BDJR::ComputeSchedule(I, S);
+  auto stop = std::chrono::steady_clock::now();
+  auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(stop-start);
+  bool ok = S.IsFeasibleForInstance(I);
+
+  std::lock_guard<std::mutex> lock(c.mutex);
+  c.out.BeginInstance(name, I);
+  c.out.WriteResult("BDJR", makespan, ms.count(), ok, S);
+  if (options.budget.count() > 0) {
+    std::string note = std::string("BDJR stage: ") + BDJR::StageName(stage);
+    c.out.WriteNote(note.c_str());
+  }
+}
+
+bool Serve(std::FILE* in, std::shared_ptr<Connection> c, Workers& workers, const Server::Options& options) {
+  for (nat index = 1; ; ++index) {
+    auto name = std::make_shared<std::string>();
+    auto I = std::make_shared<Instance>();
+    const char* error = nullptr;
+    switch (ReadRequest(in, index, *name, *I, error)) {
+      case Request::End:
+        return true;
+      case Request::Error: {
+        std::lock_guard<std::mutex> lock(c->mutex);
+        std::string note = std::string("ERROR request ") + std::to_string(index) + ": " + error;
+        c->out.WriteNote(note.c_str());
+        return false;
+      }
+      case Request::Ok:
+        workers.Submit([options, c, name, I] { Solve(options, *c, *name, *I); });
+        break;
+    }
+  }
+}
+
+}
+
+bool Server::ServeStream(std::FILE* in, std::FILE* out, const Options& options) {
+  cached_min_machines = 1 << 16;
+  Workers workers(options.workers, 2 * options.workers);
+  return Serve(in, std::make_shared<Connection>(out, false, options.format), workers, options);
+}
+
+bool Server::ServeSocket(const char* path, const Options& options) {
+  cached_min_machines = 1 << 16;
+  std::signal(SIGPIPE, SIG_IGN); // clients may leave before their responses
+
+  int server = socket(AF_UNIX, SOCK_STREAM, 0);
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  if (server < 0 || std::strlen(path) >= sizeof(address.sun_path)) {
+    std::cerr << "Cannot create socket " << path << std::endl;
+    return false;
+  }
+  std::strcpy(address.sun_path, path);
+  struct stat status;
+  if (lstat(path, &status) == 0) {
+    if (!S_ISSOCK(status.st_mode)) {
+      std::cerr << "Cannot listen on " << path << ": not a socket" << std::endl;
+      close(server);
+      return false;
+    }
+    unlink(path); // left over by a previous server
+  }
+  if (bind(server, (sockaddr*)&address, sizeof(address)) < 0 || listen(server, 16) < 0) {
+    std::cerr << "Cannot listen on " << path << ": " << std::strerror(errno) << std::endl;
+    close(server);
+    return false;
+  }
+
+  // shared by all clients and never destroyed, like the server
+  Workers* workers = new Workers(options.workers, 2 * options.workers);
+  while (true) {
+    int client = accept(server, nullptr, nullptr);
+    if (client < 0) {
+      if (errno == EINTR) continue;
+      std::cerr << "accept: " << std::strerror(errno) << std::endl;
+      close(server);
+      return false;
+    }
+    std::thread([client, workers, options] {
+      std::FILE* in = fdopen(client, "rb");
+      std::FILE* out = fdopen(dup(client), "wb");
+      if (!in || !out) {
+        if (in) std::fclose(in); else close(client);
+        if (out) std::fclose(out);
+        return;
+      }
+      Serve(in, std::make_shared<Connection>(out, true, options.format), *workers, options);
+      std::fclose(in);
+    }).detach();
+  }
+}
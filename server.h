@@ -0,0 +1,47 @@
+#ifndef SERVER_H_
+#define SERVER_H_
+
+#include <chrono>
+#include <cstdio>
+
+#include "output.h"
+
+/*
+ * Resident solver: instances are read from a stream or a Unix socket and
+ * solved by BDJR (selected rounding) on a pool of workers, so that FFTW
+ * plans, idle tensors (TensorPool) and the results of MinMachines stay warm
+ * between requests.
+ *
+ * A request is either PSMF text, i.e. the whitespace separated numbers
+ *   m n p_1 ... p_n
+ * and named by its position "#k" on the connection, or the binary 'I' record
+ * of ScheduleWriter (the leading "BDJR" magic is optional):
+ *   'I' name m d (p a)^d
+ * Framings can be mixed, the first non-blank byte of a request decides.
+ *
+ * Every response consists of the instance record and the "BDJR" result
+ * record in the output format of the server (plus a stage note with a
+ * deadline), written in the order the solves complete. A malformed request
+ * (also no machines, no jobs or a job of size 0) is answered by an "ERROR"
+ * note and ends the connection.
+ */
+namespace PCmax { namespace Server {
+
+  struct Options {
+    OutputFormat format = OutputFormat::Compact;
+    int workers = 2;                       // concurrent solves
+    std::chrono::milliseconds budget{0};   // anytime BDJR if positive
+  };
+
+  /* Serves the requests of in until its end, responses go to out. */
+  bool ServeStream(std::FILE* in, std::FILE* out, const Options& options);
+
+  /*
+   * Accepts connections on a Unix socket at path until the process ends.
+   * A socket left at path is replaced, any other file is an error.
+   */
+  bool ServeSocket(const char* path, const Options& options);
+
+}}
+
+#endif // SERVER_H_
@@ -0,0 +1,119 @@
+#include "shard.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "interrupt.h"
+
+static int processes = 0;
+
+void Shard::SetProcesses(int processes_) {
+  processes = processes_;
+}
+
+int Shard::Processes() {
+  return processes;
+}
+
+bool Shard::Create(Segment& segment, std::size_t size) {
+  void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (p == MAP_FAILED) return false;
+  segment.data = p;
+  segment.size = size;
+  return true;
+}
+
+void Shard::Destroy(Segment& segment) {
+  if (segment.data) munmap(segment.data, segment.size);
+  segment.data = nullptr;
+}
+
+/*
+ * The allowed CPUs of this process grouped by physical package.
+ */
+static const std::vector<cpu_set_t>& Sockets() {
+  static const std::vector<cpu_set_t> sockets = [] {
+    std::vector<cpu_set_t> sockets;
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) < 0) return sockets;
+    std::map<int, cpu_set_t> packages;
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      if (!CPU_ISSET(cpu, &allowed)) continue;
+      int package = 0;
+      std::ifstream file("/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/physical_package_id");
+      file >> package;
+      auto p = packages.find(package);
+      if (p == packages.end()) {
+        p = packages.emplace(package, cpu_set_t()).first;
+        CPU_ZERO(&p->second);
+      }
+      CPU_SET(cpu, &p->second);
+    }
+    for (auto const& p : packages) sockets.push_back(p.second);
+    return sockets;
+  }();
+  return sockets;
+}
+
+bool Shard::Run(const std::function<void(int)>& work, std::atomic_int& stop) {
+  const std::vector<cpu_set_t>& sockets = Sockets();
+  std::vector<pid_t> workers;
+  bool ok = true;
+
+  std::fflush(nullptr); // the children leave by _exit, without flushing
+  for (int k = 0; k < processes; ++k) {
+    pid_t pid = fork();
+    if (pid == 0) {
+      // Only this thread lives on in the child, the OpenMP runtime cannot
+      // start a team after fork: the team are plain threads, pinned as well
+      int threads = 1;
+      if (!sockets.empty()) {
+        int s = k % sockets.size(), n = sockets.size();
+        int sharing = (processes - s + n - 1) / n; // workers on socket s
+        sched_setaffinity(0, sizeof(cpu_set_t), &sockets[s]);
+        threads = std::max(1, CPU_COUNT(&sockets[s]) / sharing);
+      }
+      std::vector<std::thread> team;
+      for (int t = 1; t < threads; ++t) team.emplace_back(work, k);
+      work(k);
+      for (auto& t : team) t.join();
+      _exit(0);
+    }
+    if (pid < 0) {
+      std::cerr << "fork: " << std::strerror(errno) << std::endl;
+      stop = 1;
+      ok = false;
+      break;
+    }
+    workers.push_back(pid);
+  }
+
+  while (!workers.empty()) {
+    if (Interrupt::Requested()) stop = 1;
+    for (std::size_t k = 0; k < workers.size(); ) {
+      int status;
+      pid_t pid = waitpid(workers[k], &status, WNOHANG);
+      if (pid == 0) {
+        ++k;
+        continue;
+      }
+      if (pid < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) ok = false;
+      workers[k] = workers.back();
+      workers.pop_back();
+    }
+    if (!workers.empty()) usleep(200);
+  }
+  return ok;
+}
@@ -0,0 +1,46 @@
+#ifndef SHARD_H_
+#define SHARD_H_
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+
+/*
+ * Local worker processes for ShardedFFTConvolution. The data they share
+ * lives in an anonymous shared mapping; the workers are forked for every
+ * run, so they inherit it and also see the (read-only) memory of the
+ * parent. Nothing is left in /dev/shm if the process is killed. Each worker
+ * is pinned to the CPUs of one socket, round robin, and runs a team of
+ * threads, one per CPU of its share of the socket. Their buffers are
+ * allocated after pinning and hence placed on the memory of that socket.
+ * With one worker per socket, all CPUs take part as with threads.
+ */
+namespace Shard {
+
+  /* Worker processes per run, 0 (default) disables sharding. */
+  void SetProcesses(int processes);
+
+  int Processes();
+
+  struct Segment {
+    void* data = nullptr;
+    std::size_t size = 0;
+  };
+
+  /* Zeroed shared segment of size bytes. */
+  bool Create(Segment& segment, std::size_t size);
+
+  void Destroy(Segment& segment);
+
+  /*
+   * Runs work(k) on every thread of the team of worker process k for
+   * k < Processes() and waits for all of them, so work has to be thread
+   * safe. stop (in shared memory) is set once the caller is interrupted
+   * (see interrupt.h). Returns false if a worker could not be started or
+   * did not exit normally.
+   */
+  bool Run(const std::function<void(int)>& work, std::atomic_int& stop);
+
+}
+
+#endif // SHARD_H_
@@ -0,0 +1,118 @@
+#ifndef SMALLJOBS_H_
+#define SMALLJOBS_H_
+
+#include <algorithm>
+#include <functional>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+#include "pcmax.h"
+#include "classification.h"
+
+namespace PCmax {
+
+/*
+ * Small jobs per machine from which PlaceSmallJobs fills the machines to a
+ * water level first; fewer are placed by LPT alone.
+ */
+constexpr nat kWaterFillJobs = 32;
+
+/*
+ * Places the small jobs on top of S in decreasing order and returns the
+ * makespan. They go to the least loaded machine as in LPT on top of S,
+ * several at once while it stays the least loaded (ties to the lower
+ * machine), which is the LPT schedule in runs of equal jobs.
+ *
+ * With many small jobs, the machines are first filled in increasing order
+ * of load up to W - p_max with runs that do not cross it, where W is the
+ * largest level such that filling all machines up to W takes at most the
+ * volume of the small jobs. The placement then takes O((m + k) log m)
+ * decisions for k sizes, and LPT only places the last jobs, a volume of
+ * about m * p_max. Since S keeps every job, writing the n small jobs into
+ * it still takes O(n).
+ *
+ * Every job starts at most at W or at the least load, both at most the
+ * average final load, so the makespan keeps the bound of LPT on top of S:
+ * at most the larger of max(S) and average + largest small job.
+ */
+template<class R>
+inline nat PlaceSmallJobs(const JobClasses<R>& C, nat m, Schedule& S) {
+  std::vector<nat> load(m, 0);
+  for (nat u = 0; u < S.size(); ++u) {
+    for (nat p : S[u]) load[u] += p;
+  }
+  auto const& jobs = C.small_jobs;
+  nat volume = 0, n = 0;
+  for (auto const& j : jobs) {
+    volume += j.p * j.a;
+    n += j.a;
+  }
+
+  std::vector<nat> order;
+  nat W = 0;
+  if (n >= kWaterFillJobs * m) {
+    order.resize(m);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&load](nat u, nat v) {
+      return load[u] < load[v] || (load[u] == load[v] && u < v);
+    });
+    nat sum = 0;
+    for (nat i = 1; i <= m; ++i) {
+      sum += load[order[i-1]];
+      W = (volume + sum) / i;
+      if (i == m || W < load[order[i]]) break;
+    }
+    W = W < jobs[0].p ? 0 : W - jobs[0].p;
+  }
+
+  std::size_t j = 0;
+  nat left = jobs.empty() ? 0 : jobs[0].a;
+  for (nat u : order) {
+    if (j == jobs.size() || load[u] >= W) break;
+    nat d = W - load[u];
+    while (j < jobs.size() && jobs[j].p <= d) {
+      nat p = jobs[j].p;
+      nat c = std::min(left, d / p);
+      S.AddLoads(u, p, c);
+      load[u] += c * p;
+      d -= c * p;
+      left -= c;
+      if (left > 0) break;
+      if (++j < jobs.size()) left = jobs[j].a;
+    }
+  }
+
+  typedef std::pair<nat,nat> Entry; // (load, machine)
+  std::vector<Entry> heap;
+  if (j < jobs.size()) {
+    for (nat u = 0; u < m; ++u) heap.emplace_back(load[u], u);
+    std::make_heap(heap.begin(), heap.end(), std::greater<Entry>());
+  }
+  for (; j < jobs.size(); ++j, left = j < jobs.size() ? jobs[j].a : 0) {
+    nat p = jobs[j].p;
+    while (left > 0) {
+      std::pop_heap(heap.begin(), heap.end(), std::greater<Entry>());
+      Entry e = heap.back();
+      heap.pop_back();
+      // jobs that start at most at the next least load
+      nat c = heap.empty() ? left : std::min(left, (heap.front().first - e.first) / p + 1);
+      if (!heap.empty() && heap.front().first == e.first + (c-1) * p && heap.front().second < e.second) {
+        c = std::max<nat>(c - 1, 1);
+      }
+      S.AddLoads(e.second, p, c);
+      load[e.second] += c * p;
+      left -= c;
+      heap.emplace_back(load[e.second], e.second);
+      std::push_heap(heap.begin(), heap.end(), std::greater<Entry>());
+    }
+  }
+
+  nat makespan = 0;
+  for (nat u = 0; u < m; ++u) makespan = std::max(makespan, load[u]);
+  return makespan;
+}
+
+}
+
+#endif // SMALLJOBS_H_
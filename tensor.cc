@@ -2,54 +2,46 @@
 #include "tensor.h"
 
 #include "rounding.h"
+#include "configurations.h"
 
+/*
+ * Scatters the precomputed vectors of ConfigurationTable<R> relative to the
+ * anchor. Entries which leave the deviation of the tensor are skipped.
+ */
 template<class R>
 void Tensor<R>::Initialize(Vector<R>& anchor) {
-  Vector<R> s;
+  constexpr const ConfigurationTable<R>& table = kConfigurationTable<R>;
   Reset();
 
-  // zero vector
-  s.Reset();
-  s -= anchor;
-  Set(s, 0);
-
-  // non-negative vectors with bounded l1 norm
-  for (std::size_t norm=1; norm<=R::MaxL1Norm(); ++norm) {
-    std::size_t num_combinations = 1;
-    for (std::size_t i=0; i<norm; ++i) {
-      num_combinations *= R::Dim();
-    }
-    for (std::size_t code=0; code<num_combinations; ++code) {
-      s.Reset();
-      std::size_t remainder = code;
-      for (std::size_t i=0; i<norm; ++i) {
-        int d = remainder % R::Dim();
-        remainder = remainder / R::Dim();
-        s[d] = s[d] + 1;
-      }
-      // This enumerates all non-negative s with bounded l1 norm
-      if (s.Volume() <= R::Makespan() - R::Precision()) {
-        s -= anchor;
-        Set(s, 1);
-      }
-    }
+  // index of the zero vector, i.e. of -anchor
+  std::ptrdiff_t stride[R::Dim()];
+  std::ptrdiff_t origin = 0, s = 1;
+  int outside = 0;
+  for (int i=0; i<R::Dim(); ++i) {
+    stride[i] = s;
+    origin += -anchor[i] * s;
+    outside += (unsigned)-anchor[i] >= (unsigned)R::Deviation(i);
+    s *= R::Deviation(i);
   }
 
-  // substitutions
-  for (int i=0; i<R::Dim(); ++i) {
-    for (int j=0; j<R::Dim(); ++j) {
-      for (int k=0; k<R::Dim(); ++k) {
-        // Substitude i for j and k
-        s.Reset();
-        s[i] = -1;
-        s[j] = 1;
-        s[k] = s[k] + 1;
-        if (std::abs(s.Volume()) <= R::Precision()) {
-          s -= anchor;
-          Set(s, 0);
-        }
-      }
+  auto scatter = [&](const typename ConfigurationTable<R>::Entry& e, int v) {
+    std::ptrdiff_t idx = origin;
+    int valid = 1, fixed = 0;
+    for (int t=0; t<e.terms; ++t) {
+      int i = e.axis[t];
+      valid &= (unsigned)(e.delta[t] - anchor[i]) < (unsigned)R::Deviation(i);
+      fixed += (unsigned)-anchor[i] >= (unsigned)R::Deviation(i);
+      idx += e.delta[t] * stride[i];
     }
+    if (valid && fixed == outside) data_[idx] = v;
+  };
+
+  if (outside == 0) data_[origin] = 0;
+  for (int c=0; c<table.num_configurations; ++c) {
+    scatter(table.configurations[c], 1);
+  }
+  for (int c=0; c<table.num_substitutions; ++c) {
+    scatter(table.substitutions[c], 0);
   }
 }
 
@@ -5,21 +5,41 @@
 #include <cstring>
 #include <cassert>
 #include <atomic>
+#include <mutex>
+#include <new>
+#include <ostream>
+#include <vector>
 
 #include "vector.h"
+#include "memory.h"
 
 template<class R>
 class Tensor {
  public:
 
+  /*
+   * Constructs the entries on the uninitialized memory, which is their
+   * first touch. Large tensors are touched with a static schedule, like the
+   * loops over the target entries of the naive and sharded engines; FFT and
+   * blocked schedule their work dynamically and only get the pages spread
+   * evenly over the threads.
+   */
   Tensor() :
-    data_(new std::atomic_int[data_size()])
+    data_(static_cast<std::atomic_int*>(Memory::Allocate(data_size() * sizeof(std::atomic_int))))
   {
+    std::atomic_int* data = data_.get();
+    #pragma omp parallel for schedule(static) if (data_size() >= (1 << 16))
+    for (std::size_t i=0; i<data_size(); ++i) {
+      new (&data[i]) std::atomic_int(-1);
+    }
   }
 
+  /* Relaxed stores, so no other thread may access the tensor meanwhile. */
   inline void Reset(int v = -1) {
+    std::atomic_int* data = data_.get();
+    #pragma omp parallel for schedule(static) if (data_size() >= (1 << 16))
     for (std::size_t i=0; i<data_size(); ++i) {
-      data_[i] = v;
+      data[i].store(v, std::memory_order_relaxed);
     }
   }
 
@@ -43,6 +63,10 @@ class Tensor {
     return data_.get();
   }
 
+  const std::atomic_int* data_unsafe() const {
+    return data_.get();
+  }
+
   static inline std::size_t ToIndex(const Vector<R>& s) {
     assert(s.IsWithinDeviation());
     std::size_t idx = 0;
@@ -64,12 +88,76 @@ class Tensor {
     assert(s.IsWithinDeviation());
   }
 
+  void swap(Tensor<R>& other) {
+    data_.swap(other.data_);
+  }
+
   inline bool operator==(const Tensor<R>& rhs) const {
     return !memcmp(data_.get(), rhs.data_.get(), data_size() * sizeof(int));
   }
 
  private:
-  std::unique_ptr<std::atomic_int[]> data_;
+  struct Free {
+    void operator()(std::atomic_int* p) const {
+      Memory::Free(p, data_size() * sizeof(std::atomic_int));
+    }
+  };
+
+  std::unique_ptr<std::atomic_int[], Free> data_;
+};
+
+/*
+ * Idle tensors of rounding R kept for reuse, which saves the mapping and
+ * first touch of every MinMachines call. A lease hands its tensor back on
+ * destruction, so the pool never holds more tensors than were in use at
+ * the same time. Leased tensors have arbitrary contents.
+ */
+template<class R>
+class TensorPool {
+  struct Release {
+    void operator()(Tensor<R>* t) const {
+      std::lock_guard<std::mutex> lock(mutex_);
+      idle_.emplace_back(t);
+    }
+  };
+
+ public:
+  using Lease = std::unique_ptr<Tensor<R>, Release>;
+
+  static Lease Acquire() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!idle_.empty()) {
+        Lease t(idle_.back().release());
+        idle_.pop_back();
+        return t;
+      }
+    }
+    return Lease(new Tensor<R>());
+  }
+
+ private:
+  static inline std::mutex mutex_;
+  static inline std::vector<std::unique_ptr<Tensor<R>>> idle_;
 };
 
+/*
+ * Number of entries in which a and b differ. The first `report` of them are
+ * written to out, one per line as "coordinates: a b".
+ */
+template<class R>
+std::size_t Diff(const Tensor<R>& a, const Tensor<R>& b, std::ostream& out, std::size_t report = 10) {
+  std::size_t differences = 0;
+  for (std::size_t i = 0; i < Tensor<R>::data_size(); ++i) {
+    int va = a.data_unsafe()[i], vb = b.data_unsafe()[i];
+    if (va == vb) continue;
+    if (differences++ < report) {
+      Vector<R> s;
+      Tensor<R>::FromIndex(s, i);
+      out << s << ": " << va << " " << vb << std::endl;
+    }
+  }
+  return differences;
+}
+
 #endif // TENSOR_H_
@@ -0,0 +1,88 @@
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "dynamic.h"
+#include "log.h"
+
+/*
+ * Inserts and removes random jobs in a DynamicSchedule and checks after each
+ * change that the schedule is feasible for the jobs, that the small loads of
+ * the state follow it, and that the makespan is within the drift threshold
+ * unless fewer than kMinChanges changes were made since the last solve.
+ */
+
+using namespace PCmax;
+
+static bool Check(const DynamicSchedule& D, const BDJR::RoundingInfo& rounding, double ratio, int step) {
+  Schedule S = D.GetSchedule();
+  const Instance& I = D.GetInstance();
+  if (!S.IsFeasibleForInstance(I) || S.ComputeMakespan() != D.Makespan()) {
+    std::printf("FAILED: schedule at step %d\n", step);
+    return false;
+  }
+  const BDJR::State& state = D.GetState();
+  for (nat u = 0; u < S.size(); ++u) {
+    nat small = 0;
+    for (nat p : S[u]) if (state.T == 0 || p / (double)state.T <= rounding.eps) small += p;
+    if (small != state.small_loads[u]) {
+      std::printf("FAILED: small load of machine %zu at step %d\n", (std::size_t)u, step);
+      return false;
+    }
+  }
+  double threshold = std::max(ratio, D.SolvedRatio() + DynamicSchedule::kDriftMargin);
+  if (!I.GetMap().empty() && D.Changes() >= DynamicSchedule::kMinChanges &&
+      D.Makespan() > threshold * LowerBound(I)) {
+    std::printf("FAILED: makespan %zu above the threshold at step %d\n", (std::size_t)D.Makespan(), step);
+    return false;
+  }
+  return true;
+}
+
+int main() {
+  verbose = false;
+  const BDJR::RoundingInfo* rounding = nullptr;
+  for (auto const& r : BDJR::Roundings()) if (std::string(r.name) == "arithmetic4") rounding = &r;
+  if (!rounding) return 1;
+
+  const int steps = 2000;
+  int failed = 0;
+  for (double ratio : {0.0, 1.003}) {
+    std::mt19937 rng(7);
+    DynamicSchedule D(10, *rounding, ratio);
+    std::vector<nat> jobs;
+    if (D.Remove(5)) {
+      std::printf("FAILED: removed a job of an empty schedule\n");
+      ++failed;
+    }
+    for (int step = 0; step < steps && failed == 0; ++step) {
+      if (jobs.size() < 20 || rng() % 3) {
+        nat p = rng() % 4 ? 1 + rng() % 20 : 50 + rng() % 150; // small and large jobs
+        jobs.push_back(p);
+        D.Insert(p);
+      } else {
+        std::size_t k = rng() % jobs.size();
+        if (!D.Remove(jobs[k])) {
+          std::printf("FAILED: remove %zu at step %d\n", (std::size_t)jobs[k], step);
+          ++failed;
+        }
+        jobs[k] = jobs.back();
+        jobs.pop_back();
+      }
+      if (!Check(D, *rounding, ratio > 0 ? ratio : rounding->ratio, step)) ++failed;
+    }
+    // at most one solve per kMinChanges changes
+    if (D.Resolves() > steps / DynamicSchedule::kMinChanges) {
+      std::printf("FAILED: %zu solves in %d changes\n", (std::size_t)D.Resolves(), steps);
+      ++failed;
+    }
+    D.Resolve();
+    if (D.GetState().T == 0 || !Check(D, *rounding, rounding->ratio, steps)) ++failed;
+  }
+
+  if (failed > 0) return 1;
+  std::printf("dynamic: schedules stay feasible and within the drift threshold\n");
+  return 0;
+}
@@ -0,0 +1,71 @@
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+
+#include "server.h"
+#include "log.h"
+
+/*
+ * Checks that the server answers malformed requests by an ERROR note and
+ * still solves the requests before them, and that it does not replace a
+ * file at the socket path that is not a socket.
+ */
+
+using namespace PCmax;
+
+// Output of ServeStream for the requests, false if it did not fail
+static bool Fails(const char* requests, std::string& output) {
+  std::FILE* in = std::tmpfile();
+  std::FILE* out = std::tmpfile();
+  std::fputs(requests, in);
+  std::rewind(in);
+  Server::Options options;
+  options.workers = 1;
+  bool ok = Server::ServeStream(in, out, options);
+  std::rewind(out);
+  output.clear();
+  char buffer[256];
+  while (std::fgets(buffer, sizeof(buffer), out)) output += buffer;
+  std::fclose(in);
+  std::fclose(out);
+  return !ok;
+}
+
+int main() {
+  verbose = false;
+  int failed = 0;
+
+  struct {
+    const char* requests;
+    const char* expected;
+  } cases[] = {
+    {"2 3 3 2 1\n3 2 0 0\n", "ERROR request 2: job of size 0"},
+    {"2 3 3 2 1\n3 0\n", "ERROR request 2: empty instance"},
+    {"2 3 3 2 1\n0 1 5\n", "ERROR request 2: empty instance"},
+  };
+  for (auto const& c : cases) {
+    std::string output;
+    if (!Fails(c.requests, output) || output.find(c.expected) == std::string::npos ||
+        output.find("BDJR: 3 ") == std::string::npos) {
+      std::printf("FAILED: %s\n%s\n", c.expected, output.c_str());
+      ++failed;
+    }
+  }
+
+  char path[] = "/tmp/test_server_XXXXXX";
+  int fd = mkstemp(path);
+  Server::Options options;
+  if (fd < 0 || Server::ServeSocket(path, options) || access(path, F_OK) != 0) {
+    std::printf("FAILED: socket path of a regular file\n");
+    ++failed;
+  }
+  if (fd >= 0) {
+    close(fd);
+    unlink(path);
+  }
+
+  if (failed > 0) return 1;
+  std::printf("server: malformed requests and socket paths are rejected\n");
+  return 0;
+}
@@ -0,0 +1,94 @@
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "rounding.h"
+#include "classification.h"
+#include "heuristic.h"
+#include "smalljobs.h"
+
+/*
+ * Checks PlaceSmallJobs against LPT::ComputeSchedule on top of the same
+ * partial schedule: with fewer than kWaterFillJobs small jobs per machine
+ * the loads of all machines are those of LPT, with more (water filling)
+ * the makespan is at most max(max(S), average + p_max). Few job sizes and
+ * loads give many ties, and every tenth instance has a single machine.
+ */
+
+using namespace PCmax;
+
+typedef ArithmeticRounding<5> R;
+
+static std::vector<nat> Loads(const Schedule& S, nat m) {
+  std::vector<nat> loads(m, 0);
+  for (nat u = 0; u < S.size(); ++u) {
+    for (nat p : S[u]) loads[u] += p;
+  }
+  return loads;
+}
+
+int main() {
+  std::mt19937 rng(1);
+  int failed = 0, water_fills = 0;
+
+  for (int it = 0; it < 2000; ++it) {
+    nat m = it % 10 == 0 ? 1 : 2 + rng() % 12;
+
+    // partial schedule on some of the machines, as after the medium jobs
+    Schedule S;
+    S.resize(rng() % (m + 1));
+    for (auto& conf : S) {
+      for (nat k = rng() % 3; k > 0; --k) conf.push_back(100 * (1 + rng() % 3));
+    }
+
+    std::map<nat,nat> small;
+    nat per_machine = it % 2 ? kWaterFillJobs + rng() % 40 : rng() % kWaterFillJobs;
+    for (nat k = 0; k < per_machine * m; ++k) ++small[1 + rng() % (it % 3 ? 4 : 40)];
+
+    JobClasses<R> C(Epsilon<R>(), 1000);
+    for (auto i = small.rbegin(); i != small.rend(); ++i) {
+      C.small_jobs.push_back(JobClasses<R>::Jobs{i->first, i->second, R::Dim()});
+    }
+
+    Schedule expected = S;
+    Instance I(m, small);
+    LPT::ComputeSchedule(I, expected);
+    Schedule placed = S;
+    nat makespan = PlaceSmallJobs<R>(C, m, placed);
+
+    std::vector<nat> loads = Loads(placed, m), before = Loads(S, m);
+    nat volume = 0, max_S = 0, p_max = small.empty() ? 0 : small.rbegin()->first, total = 0;
+    for (auto const& j : small) volume += j.first * j.second;
+    for (nat u = 0; u < m; ++u) {
+      max_S = std::max(max_S, before[u]);
+      total += before[u];
+    }
+    total += volume;
+
+    bool ok = makespan == *std::max_element(loads.begin(), loads.end());
+    // every small job placed once on top of S
+    std::map<nat,nat> added;
+    for (nat u = 0; u < placed.size(); ++u) {
+      for (nat k = u < S.size() ? S[u].size() : 0; k < placed[u].size(); ++k) ++added[placed[u][k]];
+    }
+    ok = ok && added == small;
+    nat n = 0;
+    for (auto const& j : small) n += j.second;
+    if (n < kWaterFillJobs * m) {
+      ok = ok && loads == Loads(expected, m);
+    } else {
+      ++water_fills;
+      ok = ok && (makespan <= max_S || makespan * m <= total + p_max * m);
+    }
+    if (!ok) {
+      std::printf("FAILED: instance %d (m = %zu, n = %zu)\n", it, (std::size_t)m, (std::size_t)n);
+      ++failed;
+    }
+  }
+
+  if (failed > 0 || water_fills == 0) return 1;
+  std::printf("small jobs: LPT loads and the LPT bound hold\n");
+  return 0;
+}
@@ -0,0 +1,103 @@
+#include <cmath>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "rounding.h"
+#include "classification.h"
+#include "unround.h"
+
+/*
+ * Checks that UnroundScheduleOfMediumJobs places every medium job like a
+ * linear scan over the configuration groups with a free slot of its class
+ * for the least loaded next machine (ties to the lower group), where the
+ * machines of a group take the jobs of a class in turn, on random
+ * configurations and jobs.
+ */
+
+using namespace PCmax;
+
+typedef ArithmeticRounding<5> R;
+
+// Job of class d for makespan T
+static nat JobOfClass(int d, nat T, std::mt19937& rng) {
+  double lo = R::Size(d) / (double)R::Makespan();
+  double hi = d + 1 < R::Dim() ? R::Size(d+1) / (double)R::Makespan() : 1 - 2*Epsilon<R>();
+  nat p = (nat)std::ceil((lo + (hi - lo) * (rng() % 1000) / 1000.0) * T);
+  while (RoundedIndex<R>(p / (double)T) > d) --p;
+  while (RoundedIndex<R>(p / (double)T) < d) ++p;
+  return p;
+}
+
+int main() {
+  constexpr double eps = Epsilon<R>();
+  const nat T = 1000;
+  std::mt19937 rng(1);
+  int failed = 0;
+
+  for (int it = 0; it < 1000; ++it) {
+    Configurations<R> S_;
+    int groups = 1 + rng() % 6;
+    for (int k = 0; k < groups; ++k) {
+      Vector<R> c;
+      c.Reset();
+      for (int d = 0; d < R::Dim(); ++d) c[d] = rng() % 3;
+      S_.emplace_back(c, 1 + rng() % 5);
+    }
+
+    std::vector<nat> first;
+    nat machines = 0;
+    for (auto const& c : S_) {
+      first.push_back(machines);
+      machines += c.second;
+    }
+    std::map<nat,nat> jobs;
+    for (int d = 0; d < R::Dim(); ++d) {
+      int free = 0;
+      for (auto const& c : S_) free += c.first[d] * c.second;
+      for (int k = 0; k < free; ++k) {
+        nat p = JobOfClass(d, T, rng);
+        if (p / (double)T > eps && p / (double)T < 1 - 2*eps) ++jobs[p];
+      }
+    }
+
+    // Reference: linear scan over the groups per job in decreasing order
+    std::vector<nat> loads(machines, 0);
+    std::vector<std::vector<nat>> placed(S_.size(), std::vector<nat>(R::Dim(), 0));
+    Schedule expected;
+    expected.resize(machines);
+    for (auto i = jobs.rbegin(); i != jobs.rend(); ++i) {
+      int j = RoundedIndex<R>(i->first / (double)T);
+      for (nat k = 0; k < i->second; ++k) {
+        nat best = machines, best_g = 0;
+        for (nat g = 0; g < S_.size(); ++g) {
+          nat n = placed[g][j];
+          if (n >= (nat)S_[g].first[j] * S_[g].second) continue;
+          nat u = first[g] + n % S_[g].second;
+          if (best == machines || loads[u] < loads[best]) {
+            best = u;
+            best_g = g;
+          }
+        }
+        ++placed[best_g][j];
+        loads[best] += i->first;
+        expected[best].push_back(i->first);
+      }
+    }
+
+    JobClasses<R> C(eps, T);
+    C.Classify(jobs);
+    Schedule S;
+    S.resize(expected.size());
+    UnroundScheduleOfMediumJobs<R>(C, 0, S_, S);
+    if (S != expected) {
+      std::printf("FAILED: configuration set %d\n", it);
+      ++failed;
+    }
+  }
+
+  if (failed > 0) return 1;
+  std::printf("unround: all placements equal the scan over the groups\n");
+  return 0;
+}
@@ -0,0 +1,83 @@
+#ifndef UNROUND_H_
+#define UNROUND_H_
+
+#include <algorithm>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "pcmax.h"
+#include "classification.h"
+#include "scheduler.h"
+
+namespace PCmax {
+
+/*
+ * Every medium job goes to a configuration group with a free slot of its
+ * class, and within the group to its machines in turn. The group is the one
+ * whose next machine is least loaded; ties go to the lower group. The jobs
+ * of a class are consecutive since RoundedIndex is monotone, so a min-heap
+ * of (load of the next machine, group) over the groups with slots of class
+ * j is built when its first job comes. A machine is in a single group, so
+ * only the key of the popped group changes. The work is O(#groups) per
+ * class and O(log #groups) per job, independent of the number of machines.
+ */
+template<class R>
+inline void UnroundScheduleOfMediumJobs(const JobClasses<R>& C, nat huge_machines,
+  const Configurations<R>& S_, Schedule& S) {
+  std::vector<nat> first(S_.size());
+  nat machines = 0;
+  for (nat g = 0; g < S_.size(); g++) {
+    first[g] = machines;
+    machines += S_[g].second;
+  }
+  std::vector<nat> loads(machines);
+  std::vector<nat> placed(S_.size()); // jobs of the current class per group
+
+  typedef std::pair<nat,nat> Entry; // (load, group)
+  std::vector<Entry> heap;
+  heap.reserve(S_.size());
+  int j_ = -1;
+
+  for (auto const& i : C.medium_jobs) {
+    nat p = i.p;
+    nat a = i.a;
+    if (a == 0) continue; // paired with a huge job
+
+    int j = i.j;
+    if (j != j_) {
+      heap.clear();
+      for (nat g = 0; g < S_.size(); g++) {
+        placed[g] = 0;
+        if (S_[g].first[j] > 0) heap.emplace_back(loads[first[g]], g);
+      }
+      std::make_heap(heap.begin(), heap.end(), std::greater<Entry>());
+      j_ = j;
+    }
+
+    for (nat k = 0; k < a; k++) {
+      nat u;
+      if (heap.empty()) {
+        // only if the backtrace failed to resolve a target
+        u = std::min_element(loads.begin(), loads.end()) - loads.begin();
+      } else {
+        std::pop_heap(heap.begin(), heap.end(), std::greater<Entry>());
+        nat g = heap.back().second;
+        heap.pop_back();
+        const auto& c = S_[g];
+        u = first[g] + placed[g] % c.second;
+        if (++placed[g] < (nat)c.first[j] * c.second) {
+          nat v = first[g] + placed[g] % c.second;
+          heap.emplace_back(v == u ? loads[u] + p : loads[v], g);
+          std::push_heap(heap.begin(), heap.end(), std::greater<Entry>());
+        }
+      }
+      S.AddLoad(huge_machines + u, p);
+      loads[u] += p;
+    }
+  }
+}
+
+}
+
+#endif // UNROUND_H_
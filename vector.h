@@ -4,16 +4,56 @@
 #include <iostream>
 #include <memory>
 #include <cstring>
+#include <cstdint>
+#include <cstdlib>
 
+/* Sizes scaled by 2^30 and rounded, see Vector::ScaledVolume(). */
+constexpr std::int64_t ScaledSize(double x) {
+  return x >= 0 ? (std::int64_t)(x * (1 << 30) + 0.5) : -(std::int64_t)(-x * (1 << 30) + 0.5);
+}
+
+/* Per-lane constants of Vector<R>, padding lanes are neutral. */
+template<class R>
+struct VectorLayout {
+  static constexpr int kLanes = (R::Dim() + 15) / 16 * 16;
+
+  int deviation[kLanes];
+  std::int64_t size[kLanes];
+
+  static constexpr VectorLayout Make() {
+    VectorLayout layout{};
+    for (int i=0; i<kLanes; ++i) {
+      layout.deviation[i] = i < R::Dim() ? R::Deviation(i) : 1;
+      layout.size[i] = i < R::Dim() ? ScaledSize(R::Size(i)) : 0;
+    }
+    return layout;
+  }
+};
+
+/*
+ * The coordinates are stored in kLanes >= Dim() ints, a multiple of 16 and
+ * aligned to 64 bytes, so that every operation is a fixed number of full
+ * SIMD instructions without branches. The padding lanes are always zero.
+ * Coordinates stay 32-bit: b and the anchors hold job counts.
+ */
 template<class R>
 class Vector {
  public:
+  static constexpr int kLanes = VectorLayout<R>::kLanes;
+
+  static constexpr std::int64_t Scaled(double x) {
+    return ScaledSize(x);
+  }
+
   Vector() {
 #ifndef NDEBUG
     for (int i=0; i<R::Dim(); ++i) {
       data_[i] = 0xDEADBEEF;
     }
 #endif // NDEBUG
+    for (int i=R::Dim(); i<kLanes; ++i) {
+      data_[i] = 0;
+    }
   }
 
   inline int& operator[](int i) {
@@ -25,52 +65,58 @@ class Vector {
   }
 
   inline bool operator==(const Vector<R>& rhs) const {
-    for (int i=0; i<R::Dim(); ++i) {
-      if ((*this)[i] != rhs[i]) return false;
+    int diff = 0;
+    for (int i=0; i<kLanes; ++i) {
+      diff |= data_[i] ^ rhs.data_[i];
     }
-    return true;
+    return diff == 0;
   }
 
   inline bool operator!=(const Vector<R>& rhs) const {
-    for (int i=0; i<R::Dim(); ++i) {
-      if ((*this)[i] != rhs[i]) return true;
-    }
-    return false;
+    return !(*this == rhs);
   }
 
   inline bool IsWithinDeviation() const {
-    for (int i=0; i<R::Dim(); ++i) {
-      if (0 > (*this)[i] || (*this)[i] >= R::Deviation(i)) return false;
+    int outside = 0;
+    for (int i=0; i<kLanes; ++i) {
+      // negative coordinates wrap around to large unsigned ones
+      outside |= (unsigned)data_[i] >= (unsigned)kTables.deviation[i];
     }
-    return true;
+    return !outside;
   }
 
   inline int L1Norm() const {
     int norm = 0;
-    for (int i=0; i<R::Dim(); ++i) {
-      norm += std::abs((*this)[i]);
+    for (int i=0; i<kLanes; ++i) {
+      norm += std::abs(data_[i]);
     }
     return norm;
   }
 
   inline Vector<R>& operator+=(const Vector<R>& rhs) {
-    for (int i=0; i<R::Dim(); ++i) {
-      (*this)[i] += rhs[i];
+    for (int i=0; i<kLanes; ++i) {
+      data_[i] += rhs.data_[i];
     }
     return *this;
   }
 
   inline Vector<R>& operator-=(const Vector<R>& rhs) {
-    for (int i=0; i<R::Dim(); ++i) {
-      (*this)[i] -= rhs[i];
+    for (int i=0; i<kLanes; ++i) {
+      data_[i] -= rhs.data_[i];
     }
     return *this;
   }
 
-  inline double Volume() const {
-    double v = 0.0;
-    for (int i=0; i<R::Dim(); ++i) {
-      v += R::Size(i) * (*this)[i];
+  /*
+   * Sum of Scaled(R::Size(i)) * (*this)[i], compare with Scaled() of the
+   * bound. The rounding error of at most 2^-31 per size and job is far below
+   * R::Precision() of the roundings with fractional sizes, the others are
+   * exact.
+   */
+  inline std::int64_t ScaledVolume() const {
+    std::int64_t v = 0;
+    for (int i=0; i<kLanes; ++i) {
+      v += kTables.size[i] * data_[i];
     }
     return v;
   }
@@ -80,21 +126,25 @@ class Vector {
   }
 
   inline bool IsPositive() const {
-    for (int i = 0; i < R::Dim(); ++i) {
-      if ((*this)[i] < 0) return false;
+    int negative = 0;
+    for (int i=0; i<kLanes; ++i) {
+      negative |= data_[i] < 0;
     }
-    return true;
+    return !negative;
   }
 
   inline bool IsZero() const {
-    for (int i = 0; i < R::Dim(); ++i) {
-      if ((*this)[i] != 0) return false;
+    int nonzero = 0;
+    for (int i=0; i<kLanes; ++i) {
+      nonzero |= data_[i];
     }
-    return true;
+    return nonzero == 0;
   }
 
  private:
-  int data_[R::Dim()];
+  static constexpr VectorLayout<R> kTables = VectorLayout<R>::Make();
+
+  alignas(64) int data_[kLanes];
 };
 
 template<class R>